@@ -9,7 +9,21 @@
 #include <rtl.h>
 #include <emit-rtl.h>
 
+#include <stdio.h>
+
 #include "AsmGen.h"
+#include "BlockSummary.h"
+#include "PhaseTimer.h"
+#include "ArmISA_Functions.h"
+
+bool AsmGen::inSequence = false;
+unsigned int AsmGen::sequenceLength = 0;
+bool AsmGen::dryRun = false;
+unsigned int AsmGen::dryRunInsns = 0;
+unsigned int AsmGen::dryRunChecks = 0;
+unsigned int AsmGen::literalsAvoided = 0;
+bool AsmGen::trapDetection = false;
+vector<int> AsmGen::trapSites;
 
 /**
  * Emits: CMP reg,#number
@@ -139,9 +153,38 @@ rtx_insn* AsmGen::emitCondAddRegInt(unsigned int regNumber, int number, rtx_code
 
 /**
  * Emits: MOV reg,#number
+ * On ARMv6-M, a number outside 0..255 is loaded from a literal pool, unless it can be built with
+ * 	MOV reg,#base
+ * 	LSL reg,#shift / ADD reg,#rest / MVN reg,reg
+ * Returns the last emitted insn
  */
 rtx_insn* AsmGen::emitMovRegInt(unsigned int regNumber, int number, rtx_insn* attachRtx, basic_block bb, bool after){
 	rtx regSig = gen_rtx_REG(SImode, regNumber);
+	int base;
+	rtx_code code;
+	int operand;
+	if(synthesizeConstant(number, base, code, operand)){
+		rtx_insn* insn = emitInsn(gen_movsi(regSig, createConstInt(base)), attachRtx, bb, after);
+		rtx src;
+		switch(code){
+			case ASHIFT:
+				src = gen_rtx_ASHIFT(SImode, regSig, createConstInt(operand));
+				break;
+			case PLUS:
+				src = gen_rtx_PLUS(SImode, regSig, createConstInt(operand));
+				break;
+			case NOT:
+			default:
+				src = gen_rtx_NOT(SImode, regSig);
+				break;
+		}
+		insn = emitInsn(gen_movsi(regSig, src), insn, bb, true);
+		if(!dryRun){
+			literalsAvoided++;
+			PhaseTimer::count(STAT_LITERALS_AVOIDED, 1);
+		}
+		return insn;
+	}
 	rtx constInt = createConstInt(number);
 	rtx_insn* insn = emitInsn(gen_movsi(regSig, constInt), attachRtx, bb, after);
 	return insn;
@@ -186,10 +229,14 @@ rtx_insn* AsmGen::emitCodeLabel(unsigned int insnID, rtx_insn* attachRtx, basic_
  * Emits: BEQ .codeLabel
  */
 rtx_insn* AsmGen::emitBeq(rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after){
+	if(trapDetection){
+		return emitTrap(EQ, attachRtx, bb, after);
+	}
 	rtx regCC = gen_rtx_REG(CCmode, CC_REGNUM);
 	rtx constInt = gen_rtx_CONST_INT(VOIDmode, 0);
 	rtx eq = gen_rtx_EQ(CCmode,regCC,constInt);
 	rtx_insn* insn = emitInsn(gen_arm_cond_branch(codeLabel, eq, regCC), attachRtx, bb, after);
+	countCheck();
 	return insn;
 }
 
@@ -197,33 +244,82 @@ rtx_insn* AsmGen::emitBeq(rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block
  * Emits: BNE .codeLabel (armV7-M syntax)
  */
 rtx_insn* AsmGen::emitBne(rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after){
+	if(trapDetection){
+		return emitTrap(NE, attachRtx, bb, after);
+	}
 	rtx regCC = gen_rtx_REG(CCmode, CC_REGNUM);
 	rtx constInt = gen_rtx_CONST_INT(VOIDmode, 0);
 	rtx ne = gen_rtx_NE(CCmode,regCC,constInt);
 	rtx_insn* insn = emitInsn(gen_arm_cond_branch(codeLabel, ne, regCC), attachRtx, bb, after);
+	countCheck();
 	return insn;
 }
 
+/**
+ * Emits: B<condition> .label
+ * A plain conditional jump inside the inserted code, e.g. to skip a check.
+ * It is no check itself, so it is not counted and not turned into a trap.
+ */
+rtx_insn* AsmGen::emitCondJump(rtx_code condition, rtx_insn* label, rtx_insn* attachRtx, basic_block bb, bool after){
+	rtx regCC = gen_rtx_REG(CCmode, CC_REGNUM);
+	rtx constInt = gen_rtx_CONST_INT(VOIDmode, 0);
+	rtx cond = gen_rtx_fmt_ee(condition, CCmode, regCC, constInt);
+	return emitInsn(gen_arm_cond_branch(label, cond, regCC), attachRtx, bb, after);
+}
+
 /**
  * Emits: BHS .codelabel
  */
 rtx_insn* AsmGen::emitBhs(rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after){
+	if(trapDetection){
+		return emitTrap(GEU, attachRtx, bb, after);
+	}
 	rtx regCC = gen_rtx_REG(CCmode, CC_REGNUM);
 	rtx constInt = gen_rtx_CONST_INT(VOIDmode, 0);
 	rtx hs = gen_rtx_GEU(CCmode, regCC, constInt);
+	countCheck();
 	return emitInsn(gen_arm_cond_branch(codeLabel, hs, regCC), attachRtx, bb, after);
 }
 
+/**
+ * Emits: B .codeLabel
+ * followed by a barrier, as the next instruction is not reached by falling through
+ * Returns the barrier
+ */
+rtx_insn* AsmGen::emitJump(rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after){
+	if(dryRun){
+		dryRunInsns++;
+		return attachRtx;
+	}
+	rtx_insn* jump;
+	if(after){
+		jump = emit_jump_insn_after_noloc(gen_jump(codeLabel), attachRtx);
+	}
+	else{
+		jump = emit_jump_insn_before_noloc(gen_jump(codeLabel), attachRtx);
+	}
+	JUMP_LABEL(jump) = codeLabel;
+	LABEL_NUSES(codeLabel)++;
+	BlockSummary::insnInserted(jump, bb);
+	PhaseTimer::count(STAT_INSERTED_INSNS, 1);
+	return emit_barrier_after(jump);
+}
+
 /**
  * Emits: CMP reg,#number
  * 		  BNE .codelabel (armV6-M syntax)
  */
 rtx_insn* AsmGen::emitBne(unsigned int regNumber, int cmpNumber, rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after){
+	if(trapDetection){
+		rtx_insn* cmp = emitCmpRegInt(regNumber, cmpNumber, attachRtx, bb, after);
+		return emitTrap(NE, cmp, bb, true);
+	}
 	rtx reg = gen_rtx_REG(SImode, regNumber);
 	rtx constInt = createConstInt(cmpNumber);
 	rtx ne = gen_rtx_NE(SImode, reg, constInt);
 	rtx ITE = gen_rtx_IF_THEN_ELSE(VOIDmode, ne, gen_rtx_LABEL_REF(VOIDmode, codeLabel), pc_rtx);
 	rtx_insn* branch = emitInsn(gen_movsi(pc_rtx, ITE), attachRtx, bb, after);
+	countCheck();
 	return branch;
 }
 
@@ -252,6 +348,69 @@ rtx_insn* AsmGen::emitCall(rtx_insn* codeLabel){
 	return emit_call_insn_after_noloc(par, codeLabel);
 }
 
+/**
+ * Emits: B<inverse condition> .+4
+ * 		  UDF #site
+ * The trap that replaces a branch to the error handler with detection=trap.
+ * The short branch skips the UDF if the check passes, so no check needs a long branch.
+ * The site is the number of the trap in the current function, modulo 256.
+ */
+rtx_insn* AsmGen::emitTrap(rtx_code condition, rtx_insn* attachRtx, basic_block bb, bool after){
+	const char* skip;
+	switch(condition){
+		case EQ:
+			skip = "bne";
+			break;
+		case GEU:
+			skip = "bcc";
+			break;
+		case NE:
+		default:
+			skip = "beq";
+			break;
+	}
+	unsigned int site = trapSites.size() & 0xFF;
+	if(!dryRun && (trapSites.size() == 256)){
+		printf("\x1b[93mWarning: more than 256 checks in %s, trap sites are ambiguous (see Traps.txt)\x1b[0m\n",
+				IDENTIFIER_POINTER(DECL_NAME(current_function_decl)));
+	}
+	if(!dryRun){
+		trapSites.push_back((bb != 0x00) ? (bb->index - 2) : -1);
+	}
+	char trap[64];
+	snprintf(trap, sizeof(trap), "%s .+4\n\tudf #%u", skip, site);
+	rtx_insn* use = emitFlagsUse(attachRtx, bb, after);
+	rtx_insn* insn = emitAsmInput(ggc_strdup(trap), use, bb, true);
+	countCheck();
+	return insn;
+}
+
+/**
+ * Emits: (use (reg:CC))
+ * Marks the flags as read by the trap that follows. The branch inside the
+ * inline assembly cannot declare it (an ASM_INPUT may only come with clobbers),
+ * so without it the flags of the check would be dead for DF, the Scheduler
+ * and thumb2_reorg. It takes no space, so it is not counted as inserted.
+ */
+rtx_insn* AsmGen::emitFlagsUse(rtx_insn* attachRtx, basic_block bb, bool after){
+	if(dryRun){
+		return attachRtx;
+	}
+	rtx use = gen_rtx_USE(VOIDmode, gen_rtx_REG(CCmode, CC_REGNUM));
+	rtx_insn* insn;
+	if(inSequence){
+		return emit_insn(use);
+	}
+	else if(after){
+		insn = emit_insn_after_noloc(use, attachRtx, bb);
+	}
+	else{
+		insn = emit_insn_before_noloc(use, attachRtx, bb);
+	}
+	BlockSummary::insnInserted(insn, bb);
+	return insn;
+}
+
 /**
  * Emits the provided assembly instruction
  */
@@ -268,25 +427,201 @@ rtx_insn* AsmGen::emitAsmInput(const char* asmInstr, rtx_insn* attachRtx, basic_
 	return insn;
 }
 
-//------------------------------ Private Section --------------------- \\
-
-/*
+/**
  * Actually emits the insn at the desired place.
+ * Keeps the block summary and the statistics up to date.
+ * If a sequence is started, the insn is added to the end of the sequence instead.
  */
 rtx_insn* AsmGen::emitInsn(rtx rtxInsn,rtx_insn* attachRtx, basic_block bb, bool after){
-	if (after){
-		return emit_insn_after_noloc(rtxInsn, attachRtx, bb);
+	rtx_insn* insn;
+	if (dryRun){
+		// Keep chaining on the attach point, so the technique walks the real insns as usual
+		dryRunInsns++;
+		insn = emit_insn(rtxInsn);
+		return (attachRtx != NULL) ? attachRtx : insn;
+	}
+	else if (inSequence){
+		sequenceLength++;
+		PhaseTimer::count(STAT_INSERTED_INSNS, 1);
+		return emit_insn(rtxInsn);
+	}
+	else if (after){
+		insn = emit_insn_after_noloc(rtxInsn, attachRtx, bb);
+	}
+	else{
+		insn = emit_insn_before_noloc(rtxInsn, attachRtx, bb);
+	}
+	BlockSummary::insnInserted(insn, bb);
+	PhaseTimer::count(STAT_INSERTED_INSNS, 1);
+	return insn;
+}
+
+/**
+ * Function to start queueing the emitted insns in a new sequence
+ * Sequences cannot be nested.
+ */
+void AsmGen::startSequence(){
+	if(dryRun){
+		return;
+	}
+	if(inSequence){
+		throw "AsmGen: a sequence is already started";
+	}
+	start_sequence();
+	inSequence = true;
+	sequenceLength = 0;
+}
+
+/**
+ * Function to splice the queued insns into the basic block in one go
+ * @return The last insn of the sequence, attachRtx if the sequence is empty
+ */
+rtx_insn* AsmGen::endSequence(rtx_insn* attachRtx, basic_block bb, bool after){
+	if(dryRun){
+		return attachRtx;
+	}
+	rtx_insn* first = get_insns();
+	rtx_insn* last = get_last_insn();
+	end_sequence();
+	inSequence = false;
+	if(first == NULL){
+		return attachRtx;
+	}
+	if(after){
+		emit_insn_after_noloc(first, attachRtx, bb);
 	}
 	else{
-		return emit_insn_before_noloc(rtxInsn, attachRtx, bb);
+		emit_insn_before_noloc(first, attachRtx, bb);
+	}
+	BlockSummary::sequenceInserted(first, last, sequenceLength, bb);
+	return last;
+}
+
+/**
+ * Function to start a dry run: all emitted insns, including those of
+ * sequences, are queued in a separate insn sequence that is thrown away
+ * by endDryRun, so the RTL of the function is not changed.
+ * The inserted insns and checks are only counted, not reported in the statistics.
+ */
+void AsmGen::startDryRun(){
+	if(dryRun || inSequence){
+		throw "AsmGen: a dry run cannot be nested";
+	}
+	start_sequence();
+	dryRun = true;
+	dryRunInsns = 0;
+	dryRunChecks = 0;
+}
+
+/**
+ * Function to throw away the insns emitted during the dry run
+ * @return The number of insns that would have been inserted
+ */
+unsigned int AsmGen::endDryRun(){
+	if(!dryRun){
+		return 0;
+	}
+	end_sequence();
+	dryRun = false;
+	return dryRunInsns;
+}
+
+/**
+ * Function to determine whether a dry run is active
+ */
+bool AsmGen::isDryRun(){
+	return dryRun;
+}
+
+/**
+ * Returns the number of insns emitted since the start of the dry run
+ */
+unsigned int AsmGen::nrOfDryRunInsns(){
+	return dryRunInsns;
+}
+
+/**
+ * Returns the number of checks (branches to the error handler) emitted since the start of the dry run
+ */
+unsigned int AsmGen::nrOfDryRunChecks(){
+	return dryRunChecks;
+}
+
+/**
+ * Function to select how the checks raise an error in the current function:
+ * a branch to the error handler or a trap. Also starts a new list of trap sites.
+ */
+void AsmGen::setTrapDetection(bool trap){
+	trapDetection = trap;
+	trapSites.clear();
+}
+
+/**
+ * Function to determine whether the checks raise a trap instead of branching to the error handler
+ */
+bool AsmGen::isTrapDetection(){
+	return trapDetection;
+}
+
+/**
+ * Returns the basic block of each trap of the current function, indexed by site, -1 if unknown
+ */
+vector<int>& AsmGen::getTrapSites(){
+	return trapSites;
+}
+
+/**
+ * Returns the number of literal loads avoided by emitMovRegInt since the start of the compilation
+ */
+unsigned int AsmGen::nrOfLiteralsAvoided(){
+	return literalsAvoided;
+}
+
+//------------------------------ Private Section --------------------- \\
+
+/**
+ * Function to find two 16-bit ARMv6-M instructions that load the number without a literal pool:
+ * 	- MOV reg,#base with LSL reg,#operand for an 8-bit value shifted left, e.g. a mask of adjacent bits
+ * 	- MOV reg,#255 with ADD reg,#operand for 256 to 510
+ * 	- MOV reg,#base with MVN reg,reg for -256 to -1
+ * Both instructions set the condition flags, as the single MOVS does.
+ * @return false if the number fits a single MOV, is not for ARMv6-M or needs a literal load
+ */
+bool AsmGen::synthesizeConstant(int number, int& base, rtx_code& code, int& operand){
+	unsigned int value = (unsigned int) number;
+	if((value <= 255) || (ARM_ISA::getISAtarget(arm_cpu_option) != ARMv6M)){
+		return false;
 	}
+	if(~value <= 255){
+		base = ~value;
+		code = NOT;
+		operand = 0;
+		return true;
+	}
+	unsigned int shift = __builtin_ctz(value);
+	if((value >> shift) <= 255){
+		base = value >> shift;
+		code = ASHIFT;
+		operand = shift;
+		return true;
+	}
+	if(value <= 510){
+		base = 255;
+		code = PLUS;
+		operand = value - 255;
+		return true;
+	}
+	return false;
 }
 
 /*
  * Actually emits the codelabel at the desired place
  */
 rtx_insn* AsmGen::emitLabel(rtx label, rtx_insn* attachRtx, bool after){
-	if(after){
+	if(dryRun){
+		return emit_label(label);
+	}
+	else if(after){
 		return emit_label_after(label, attachRtx);
 	}
 	else{
@@ -294,6 +629,18 @@ rtx_insn* AsmGen::emitLabel(rtx label, rtx_insn* attachRtx, bool after){
 	}
 }
 
+/**
+ * Function to count an emitted check, in the statistics or in the dry run
+ */
+void AsmGen::countCheck(){
+	if(dryRun){
+		dryRunChecks++;
+	}
+	else{
+		PhaseTimer::count(STAT_CHECKS, 1);
+	}
+}
+
 /**
  * Method to easily create a CONST_INT rtx
  */
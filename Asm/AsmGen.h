@@ -12,6 +12,21 @@
  *
  * Code for POP and PUSH instructions is located in the according <targetISA>_Functions.cpp
  * file in the Targets folder.
+ *
+ * Between startSequence and endSequence the emitted instructions are queued
+ * in a separate insn sequence (attachRtx is then ignored). endSequence splices
+ * the whole sequence into the basic block at once.
+ *
+ * Between startDryRun and endDryRun nothing is inserted at all: the emitted
+ * instructions are only counted, to estimate the cost of a technique.
+ *
+ * On ARMv6-M, emitMovRegInt builds constants outside 0..255 with two 16-bit
+ * instructions where it can, instead of a PC-relative literal load.
+ *
+ * With trap detection, emitBeq, emitBne and emitBhs emit a conditional trap
+ * instead of the branch to the error handler (codeLabel is then ignored).
+ * The trap is preceded by a USE of the flags, so the flags of the check stay live.
+ * emitCondJump is never rewritten, it is meant for jumps inside the inserted code.
  */
 
 #ifndef ASM_ASMGEN_H_
@@ -22,6 +37,10 @@
 #include <rtl.h>
 #include <emit-rtl.h>
 
+#include <vector>
+
+using namespace std;
+
 class AsmGen{
 	public:
 		static rtx_insn* emitCmpRegInt(unsigned int regNumber, int number,rtx_insn* attachRtx, basic_block bb, bool after);
@@ -50,14 +69,47 @@ class AsmGen{
 		static rtx_insn* emitBne(rtx_insn* codelabel, rtx_insn* attachRtx, basic_block bb, bool after);
 		static rtx_insn* emitBne(unsigned int regNumber, int cmpNumber, rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after);
 		static rtx_insn* emitBhs(rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after);
+		static rtx_insn* emitCondJump(rtx_code condition, rtx_insn* label, rtx_insn* attachRtx, basic_block bb, bool after);
+		static rtx_insn* emitJump(rtx_insn* codeLabel, rtx_insn* attachRtx, basic_block bb, bool after);
+		static rtx_insn* emitTrap(rtx_code condition, rtx_insn* attachRtx, basic_block bb, bool after);
 
 		static rtx_insn* emitCall(rtx_insn* codeLabel);
 
 		static rtx_insn* emitAsmInput(const char* asmInstr, rtx_insn* attachRtx, basic_block bb, bool after);
 
-	private:
 		static rtx_insn* emitInsn(rtx rtxInsn,rtx_insn* attachRtx, basic_block bb, bool after);
+
+		static void startSequence();
+		static rtx_insn* endSequence(rtx_insn* attachRtx, basic_block bb, bool after);
+
+		static void startDryRun();
+		static unsigned int endDryRun();
+		static bool isDryRun();
+		static unsigned int nrOfDryRunInsns();
+		static unsigned int nrOfDryRunChecks();
+
+		static unsigned int nrOfLiteralsAvoided();
+
+		static void setTrapDetection(bool trap);
+		static bool isTrapDetection();
+		static vector<int>& getTrapSites();
+
+	private:
+		static bool inSequence;
+		static unsigned int sequenceLength;
+		static bool dryRun;
+		static unsigned int dryRunInsns;
+		static unsigned int dryRunChecks;
+		static unsigned int literalsAvoided;
+		static bool trapDetection;
+		static vector<int> trapSites;
+
+		static void countCheck();
+
 		static rtx_insn* emitLabel(rtx label, rtx_insn* attachRtx, bool after);
+		static rtx_insn* emitFlagsUse(rtx_insn* attachRtx, basic_block bb, bool after);
+
+		static bool synthesizeConstant(int number, int& base, rtx_code& code, int& operand);
 
 		static rtx createConstInt(int number);
 		static rtx createCondition(rtx_code condition);
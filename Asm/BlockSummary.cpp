@@ -0,0 +1,282 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include "BlockSummary.h"
+#include "InstrType.h"
+
+vector<BlockInfo> BlockSummary::blocks;
+vector<rtx_insn*> BlockSummary::realInsns;
+
+/**
+ * Function to build the summary of all basic blocks of
+ * the current function, walking each basic block once
+ */
+void BlockSummary::build(){
+	BlockInfo empty = {};
+	blocks.assign(last_basic_block_for_fn(cfun), empty);
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		summarize(bb, blocks[bb->index]);
+	}
+}
+
+/**
+ * Function to drop the summary, must be called once
+ * the current function is fully protected
+ */
+void BlockSummary::clear(){
+	blocks.clear();
+}
+
+/**
+ * Function to determine whether or not a summary
+ * is available for the current function
+ */
+bool BlockSummary::isBuilt(){
+	return !blocks.empty();
+}
+
+/**
+ * Returns the first real INSN of the basic block
+ */
+rtx_insn* BlockSummary::first(basic_block bb){
+	return blocks[bb->index].first;
+}
+
+/**
+ * Returns the middle real INSN of the original instructions of the basic block
+ */
+rtx_insn* BlockSummary::middle(basic_block bb){
+	return blocks[bb->index].middle;
+}
+
+/**
+ * Returns the last real INSN of the basic block
+ */
+rtx_insn* BlockSummary::last(basic_block bb){
+	return blocks[bb->index].last;
+}
+
+/**
+ * Returns the last INSN after which instructions can be inserted
+ * without separating the final jump from its compare
+ */
+rtx_insn* BlockSummary::lastSafe(basic_block bb){
+	BlockInfo& info = blocks[bb->index];
+	if(info.safeBoundary == 0x00){
+		return info.last;
+	}
+	return PREV_INSN(info.safeBoundary);
+}
+
+/**
+ * Returns the compare feeding the final conditional branch
+ * of the basic block, 0x00 if there is none
+ */
+rtx_insn* BlockSummary::compare(basic_block bb){
+	return blocks[bb->index].compare;
+}
+
+/**
+ * Returns the number of real instructions (No Debug or Note insn),
+ * including the inserted ones
+ */
+unsigned int BlockSummary::nrOfRealInstr(basic_block bb){
+	return blocks[bb->index].nrOfRealInstr;
+}
+
+/**
+ * Returns the number of original instructions
+ * (No Debug, Note, Use, Clobber or Unspec insn)
+ */
+unsigned int BlockSummary::nrOfOrigInstr(basic_block bb){
+	return blocks[bb->index].nrOfOrigInstr;
+}
+
+/**
+ * Returns the number of original instructions that can be
+ * verified by intra-block CFE detection (No Debug, Note, Use, Jump or Call insn)
+ */
+unsigned int BlockSummary::nrOfVerifiableInstr(basic_block bb){
+	return blocks[bb->index].nrOfVerifiableInstr;
+}
+
+/**
+ * Function to update the summary of the basic block after
+ * the provided insn has been inserted into it.
+ * Only looks at the neighbouring insns, so it runs in constant time
+ * apart from skipping debug and note insns.
+ */
+void BlockSummary::insnInserted(rtx_insn* insn, basic_block bb){
+	if(blocks.empty() || (bb == 0x00) || (bb->index < 2) || (bb->index >= blocks.size())){
+		return;
+	}
+	BlockInfo& info = blocks[bb->index];
+	info.nrOfRealInstr++;
+	if(!hasRealInsnBefore(insn, bb)){
+		info.first = insn;
+	}
+	if(!hasRealInsnAfter(insn, bb)){
+		info.last = insn;
+	}
+}
+
+/**
+ * Function to update the summary of the basic block after
+ * a sequence of length insns, from first to last, has been inserted into it.
+ */
+void BlockSummary::sequenceInserted(rtx_insn* first, rtx_insn* last, unsigned int length, basic_block bb){
+	if(blocks.empty() || (bb == 0x00) || (bb->index < 2) || (bb->index >= blocks.size())){
+		return;
+	}
+	BlockInfo& info = blocks[bb->index];
+	info.nrOfRealInstr += length;
+	if(!hasRealInsnBefore(first, bb)){
+		info.first = first;
+	}
+	if(!hasRealInsnAfter(last, bb)){
+		info.last = last;
+	}
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Function to summarize a single basic block in one walk
+ */
+void BlockSummary::summarize(basic_block bb, BlockInfo& info){
+	realInsns.clear();
+	rtx_insn* lastCompare = 0x00;
+	rtx_insn* insn;
+	FOR_BB_INSNS(bb, insn){
+		if(NONDEBUG_INSN_P(insn)){
+			realInsns.push_back(insn);
+			bool isUse = InstrType::isUse(insn);
+			if(!isUse && !InstrType::isUnspec(insn) && !InstrType::isClobber(insn) && !InstrType::isUnspecVolatile(insn)){
+				info.nrOfOrigInstr++;
+			}
+			if(!isUse && !JUMP_P(insn) && !CALL_P(insn)){
+				info.nrOfVerifiableInstr++;
+			}
+			if(InstrType::isCompare(insn)){
+				lastCompare = insn;
+			}
+		}
+	}
+	info.nrOfRealInstr = realInsns.size();
+	if(realInsns.empty()){
+		// Same as walking to the nearest real insns
+		info.first = BB_HEAD(bb);
+		while(!NONDEBUG_INSN_P(info.first)){
+			info.first = NEXT_INSN(info.first);
+		}
+		info.last = BB_END(bb);
+		while(!NONDEBUG_INSN_P(info.last)){
+			info.last = PREV_INSN(info.last);
+		}
+	}
+	else{
+		info.first = realInsns.front();
+		info.last = realInsns.back();
+	}
+
+	// Determine what the final instructions of the basic block are
+	rtx_insn* lastInsn = info.last;
+	if(InstrType::isReturn(lastInsn)){
+		info.safeBoundary = lastInsn;
+	}
+	else if(JUMP_P(lastInsn) && !InstrType::isCondJump(lastInsn)){
+		info.safeBoundary = lastInsn;
+	}
+	else if(InstrType::isCBZ(lastInsn)){
+		// A CBZ or CBNZ that was not split does not depend on a compare
+		info.safeBoundary = lastInsn;
+	}
+	else if(JUMP_P(lastInsn) && InstrType::isCondJump(lastInsn)){
+		info.compare = lastCompare;
+		info.safeBoundary = (lastCompare != 0x00) ? lastCompare : lastInsn;
+	}
+
+	info.middle = findMiddle(info);
+	if(info.middle == 0x00){
+		info.middle = BB_HEAD(bb);
+	}
+}
+
+/**
+ * Function to determine the middle real INSN of the basic block
+ * from the real insns collected by summarize.
+ * To insert instructions in the middle of the basic block
+ * attach them AFTER this INSN
+ */
+rtx_insn* BlockSummary::findMiddle(BlockInfo& info){
+	unsigned int totalINSN = realInsns.size();
+	if(totalINSN == 0){
+		return 0x00;
+	}
+	if(totalINSN != 1){			// Most cases
+		rtx_insn* middleINSN = realInsns[totalINSN/2 - 1];
+		// Make it safe to use by filtering out jump_insns and cond_exec insns
+		while( JUMP_P(middleINSN)|| InstrType::isCondExec(middleINSN) ){
+			do{
+				middleINSN = PREV_INSN(middleINSN);
+			}
+			while(!NONDEBUG_INSN_P(middleINSN));
+		}
+		if(InstrType::isCompare(middleINSN)){
+			middleINSN = PREV_INSN(middleINSN);
+		}
+		return middleINSN;
+	}
+	else{
+		rtx_insn* middleINSN = realInsns[0];
+		// filter out Return statement
+		if (InstrType::isReturn(middleINSN)){
+			middleINSN = PREV_INSN(middleINSN);
+		}
+		return middleINSN;
+	}
+}
+
+/**
+ * Function to determine whether the basic block contains
+ * a real INSN before the provided insn
+ */
+bool BlockSummary::hasRealInsnBefore(rtx_insn* insn, basic_block bb){
+	rtx_insn* prev = insn;
+	while(prev != BB_HEAD(bb)){
+		prev = PREV_INSN(prev);
+		if(prev == 0x00){
+			return false;
+		}
+		if(NONDEBUG_INSN_P(prev)){
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Function to determine whether the basic block contains
+ * a real INSN after the provided insn
+ */
+bool BlockSummary::hasRealInsnAfter(rtx_insn* insn, basic_block bb){
+	rtx_insn* next = insn;
+	while(next != BB_END(bb)){
+		next = NEXT_INSN(next);
+		if(next == 0x00){
+			return false;
+		}
+		if(NONDEBUG_INSN_P(next)){
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,81 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * This is the header file of the BlockSummary class.
+ *
+ * It contains the prototypes of the methods used to build, query and
+ * update a summary of each basic block of the current function:
+ * the first, middle, last and last safe instruction, the compare feeding
+ * the final branch and the number of real, original and verifiable instructions.
+ *
+ * The summary is built in a single pass over the function and is kept
+ * up to date by AsmGen for every instruction inserted afterwards.
+ */
+
+#ifndef ASM_BLOCKSUMMARY_H_
+#define ASM_BLOCKSUMMARY_H_
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Struct holding the summary of one basic block
+ * Contains:
+ * 	- The first and last real instruction (updated on insertion)
+ * 	- The middle real instruction of the original instructions
+ * 	- The instruction the last safe instruction precedes, 0x00 if the block does not end in a jump
+ * 	- The compare feeding the final conditional branch, 0x00 if none
+ * 	- The number of real instructions (updated on insertion)
+ * 	- The number of original and verifiable instructions
+ */
+struct BlockInfo{
+	rtx_insn* first;
+	rtx_insn* middle;
+	rtx_insn* last;
+	rtx_insn* safeBoundary;
+	rtx_insn* compare;
+	unsigned int nrOfRealInstr;
+	unsigned int nrOfOrigInstr;
+	unsigned int nrOfVerifiableInstr;
+};
+
+class BlockSummary{
+	public:
+		static void build();
+		static void clear();
+		static bool isBuilt();
+
+		static rtx_insn* first(basic_block bb);
+		static rtx_insn* middle(basic_block bb);
+		static rtx_insn* last(basic_block bb);
+		static rtx_insn* lastSafe(basic_block bb);
+		static rtx_insn* compare(basic_block bb);
+
+		static unsigned int nrOfRealInstr(basic_block bb);
+		static unsigned int nrOfOrigInstr(basic_block bb);
+		static unsigned int nrOfVerifiableInstr(basic_block bb);
+
+		static void insnInserted(rtx_insn* insn, basic_block bb);
+		static void sequenceInserted(rtx_insn* first, rtx_insn* last, unsigned int length, basic_block bb);
+
+	private:
+		static vector<BlockInfo> blocks;
+		static vector<rtx_insn*> realInsns;
+
+		static void summarize(basic_block bb, BlockInfo& info);
+		static rtx_insn* findMiddle(BlockInfo& info);
+		static bool hasRealInsnBefore(rtx_insn* insn, basic_block bb);
+		static bool hasRealInsnAfter(rtx_insn* insn, basic_block bb);
+};
+
+
+#endif /* ASM_BLOCKSUMMARY_H_ */
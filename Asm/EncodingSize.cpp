@@ -0,0 +1,169 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+#include <emit-rtl.h>
+
+#include "EncodingSize.h"
+#include "ArmISA_Functions.h"
+
+/**
+ * Function to count the inserted instructions of the current function
+ * per encoding size, including those outside the basic blocks
+ * such as the call to the error handler
+ * @param firstUID The UID of the first instruction inserted by the technique
+ * @param narrow Set to the number of 16-bit instructions
+ * @param wide Set to the number of 32-bit instructions
+ */
+void EncodingSize::count(int firstUID, unsigned int& narrow, unsigned int& wide){
+	narrow = 0;
+	wide = 0;
+	for(rtx_insn* insn = get_insns(); insn != 0x00; insn = NEXT_INSN(insn)){
+		if(!NONDEBUG_INSN_P(insn) || (INSN_UID(insn) < firstUID) || isMarker(insn)){
+			continue;
+		}
+		if(isNarrow(insn)){
+			narrow++;
+		}
+		else{
+			wide++;
+		}
+	}
+}
+
+/**
+ * Function to determine whether the insn gets a 16-bit encoding
+ */
+bool EncodingSize::isNarrow(rtx_insn* insn){
+	if(CALL_P(insn)){
+		return false;
+	}
+	if(ARM_ISA::getISAtarget(arm_cpu_option) == ARMv6M){
+		return true;
+	}
+	rtx pattern = PATTERN(insn);
+	if(JUMP_P(insn)){
+		// Only the unconditional B of a trampoline is near its target
+		return (GET_CODE(pattern) == SET) && (GET_CODE(SET_SRC(pattern)) == LABEL_REF);
+	}
+	if(GET_CODE(pattern) == COND_EXEC){
+		// Inside an IT block the 16-bit encodings do not set the flags
+		pattern = COND_EXEC_CODE(pattern);
+	}
+	return (GET_CODE(pattern) == SET) && isNarrowSet(pattern);
+}
+
+/**
+ * Function to estimate the size of the insn in bytes, for any insn of the function:
+ * 	- labels, notes, barriers and USE/CLOBBER markers take no space
+ * 	- a jump table takes its entries
+ * 	- inline assembly counts 4 bytes per line
+ * 	- other insns take 2 or 4 bytes, see isNarrow
+ * Instructions that GCC splits later, and the literal pools, are not known yet.
+ */
+unsigned int EncodingSize::sizeOf(rtx_insn* insn){
+	if(JUMP_TABLE_DATA_P(insn)){
+		rtx table = PATTERN(insn);
+		int vecIndex = (GET_CODE(table) == ADDR_DIFF_VEC) ? 1 : 0;
+		return XVECLEN(table, vecIndex) * GET_MODE_SIZE(GET_MODE(table));
+	}
+	if(!NONDEBUG_INSN_P(insn) || isMarker(insn)){
+		return 0;
+	}
+	rtx pattern = PATTERN(insn);
+	if((GET_CODE(pattern) == PARALLEL) && (GET_CODE(XVECEXP(pattern, 0, 0)) == ASM_INPUT)){
+		pattern = XVECEXP(pattern, 0, 0);
+	}
+	if(GET_CODE(pattern) == ASM_INPUT){
+		unsigned int lines = 1;
+		for(const char* c = XSTR(pattern, 0); *c != '\0'; c++){
+			lines += (*c == '\n');
+		}
+		return 4 * lines;
+	}
+	return isNarrow(insn) ? 2 : 4;
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Function to determine whether the insn is a bare USE or CLOBBER, which emits no code
+ */
+bool EncodingSize::isMarker(rtx_insn* insn){
+	rtx_code code = GET_CODE(PATTERN(insn));
+	return (code == USE) || (code == CLOBBER);
+}
+
+/**
+ * Function to determine whether the SET has a 16-bit Thumb-2 encoding
+ * 	MOVS Rd,#imm8 / MOV Rd,Rm
+ * 	ADDS/SUBS Rdn,#imm8 / ADDS/SUBS Rd,Rn,#imm3
+ * 	EORS/ANDS/ORRS/MULS Rdn,Rm
+ * 	RSBS Rd,Rn,#0 / LSLS/LSRS Rd,Rm,#imm5
+ * 	CMP Rn,#imm8 / CMP Rn,Rm
+ */
+bool EncodingSize::isNarrowSet(rtx set){
+	rtx dest = SET_DEST(set);
+	rtx src = SET_SRC(set);
+	if(GET_CODE(src) == COMPARE){
+		rtx op0 = XEXP(src, 0);
+		rtx op1 = XEXP(src, 1);
+		return (REG_P(op0) && REG_P(op1)) || (isLowReg(op0) && isImmediate(op1, 0, 255));
+	}
+	if(!REG_P(dest)){
+		return false;
+	}
+	if(REG_P(src)){
+		return true;
+	}
+	if(!isLowReg(dest)){
+		return false;
+	}
+
+	switch(GET_CODE(src)){
+		case CONST_INT:
+			return isImmediate(src, 0, 255);
+		case PLUS:
+		case MINUS:
+			if(!isLowReg(XEXP(src, 0))){
+				return false;
+			}
+			if(REGNO(XEXP(src, 0)) == REGNO(dest)){
+				return isImmediate(XEXP(src, 1), -255, 255) || isLowReg(XEXP(src, 1));
+			}
+			return isImmediate(XEXP(src, 1), -7, 7) || isLowReg(XEXP(src, 1));
+		case XOR:
+		case AND:
+		case IOR:
+		case MULT:
+			return isLowReg(XEXP(src, 0)) && isLowReg(XEXP(src, 1)) &&
+					((REGNO(XEXP(src, 0)) == REGNO(dest)) || (REGNO(XEXP(src, 1)) == REGNO(dest)));
+		case NEG:
+			return isLowReg(XEXP(src, 0));
+		case ASHIFT:
+		case LSHIFTRT:
+			return isLowReg(XEXP(src, 0)) && (isImmediate(XEXP(src, 1), 0, 31) ||
+					(isLowReg(XEXP(src, 1)) && (REGNO(XEXP(src, 0)) == REGNO(dest))));
+		default:
+			return false;
+	}
+}
+
+/**
+ * Function to determine whether the expression is one of the registers r0 to r7
+ */
+bool EncodingSize::isLowReg(rtx expr){
+	return REG_P(expr) && (REGNO(expr) <= 7);
+}
+
+/**
+ * Function to determine whether the expression is a constant in [low, high]
+ */
+bool EncodingSize::isImmediate(rtx expr, int low, int high){
+	return CONST_INT_P(expr) && (INTVAL(expr) >= low) && (INTVAL(expr) <= high);
+}
@@ -0,0 +1,43 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * This is the header file of the EncodingSize class.
+ *
+ * It contains the prototypes of the methods used to determine whether
+ * the instructions inserted by a technique get a 16-bit or a 32-bit
+ * Thumb encoding. The lengths are only known after shorten_branches,
+ * which runs after the plugin, so they are derived from the patterns:
+ * 	- ARMv6-M only has 16-bit instructions, apart from BL
+ * 	- on ARMv7-M, the 16-bit encodings need low registers and small immediates,
+ * 	  assuming the flags are free where the 16-bit encoding sets them
+ * 	- conditional branches and calls count as 32-bit, as the error handler
+ * 	  is placed at the end of the function
+ * 	- the PUSH and POP on the second stack count as 32-bit
+ */
+
+#ifndef ASM_ENCODINGSIZE_H_
+#define ASM_ENCODINGSIZE_H_
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+class EncodingSize{
+	public:
+		static void count(int firstUID, unsigned int& narrow, unsigned int& wide);
+		static bool isNarrow(rtx_insn* insn);
+		static unsigned int sizeOf(rtx_insn* insn);
+
+	private:
+		static bool isMarker(rtx_insn* insn);
+		static bool isNarrowSet(rtx set);
+		static bool isLowReg(rtx expr);
+		static bool isImmediate(rtx expr, int low, int high);
+};
+
+
+#endif /* ASM_ENCODINGSIZE_H_ */
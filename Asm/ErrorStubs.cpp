@@ -0,0 +1,203 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+#include <emit-rtl.h>
+
+#include "ErrorStubs.h"
+#include "AsmGen.h"
+#include "EncodingSize.h"
+
+// Size of a stub: BL CFED_Detected
+#define STUB_SIZE 4
+// Bytes kept free at both ends of the branch range, for the sizes that are not known yet
+#define RANGE_MARGIN 32
+
+vector<ErrorStub> ErrorStubs::stubs;
+
+/**
+ * Function to place the error stubs of the current function.
+ * @param codeLabel The label of the stub at the end of the function, placed by GeneralCFED::insertError
+ * @param farBefore Set to the number of checks that cannot reach the stub at the end of the function
+ * with a 16-bit conditional branch
+ * @param farAfter Set to the number of checks that still cannot reach a stub with a 16-bit conditional branch
+ * @param endUsed Set to whether a check still uses the stub at the end of the function, it is removed otherwise
+ * @return The number of placed stubs
+ */
+unsigned int ErrorStubs::place(rtx_insn* codeLabel, unsigned int& farBefore, unsigned int& farAfter, bool& endUsed){
+	// 1) Estimate the addresses, collect the checks and the places where a stub can go
+	vector<pair<unsigned int, rtx> > checks;
+	vector<pair<unsigned int, rtx_insn*> > barriers;
+	unsigned int address = 0;
+	unsigned int endAddress = 0;
+	rtx_insn* prevReal = 0x00;
+	for(rtx_insn* insn = get_insns(); insn != 0x00; insn = NEXT_INSN(insn)){
+		rtx ref;
+		if(insn == codeLabel){
+			endAddress = address;
+		}
+		else if(NONDEBUG_INSN_P(insn) && referencesLabel(PATTERN(insn), codeLabel, ref)){
+			checks.push_back(make_pair(address, ref));
+		}
+		else if(BARRIER_P(insn) && !((prevReal != 0x00) && JUMP_P(prevReal) && tablejump_p(prevReal, 0x00, 0x00))){
+			// Not between a table jump and its jump table
+			barriers.push_back(make_pair(address, insn));
+		}
+		if(!NOTE_P(insn)){
+			prevReal = insn;
+		}
+		address += EncodingSize::sizeOf(insn);
+	}
+
+	stubs.clear();
+	addStub(endAddress, codeLabel);
+	farBefore = 0;
+	for(unsigned int c = 0; c < checks.size(); c++){
+		farBefore += !inRange(checks[c].first, endAddress);
+	}
+
+	// 2) Give each check a stub in range, placing a new one where needed
+	vector<rtx_insn*> assigned(checks.size(), codeLabel);
+	unsigned int placed = 0;
+	for(unsigned int c = 0; c < checks.size(); c++){
+		int found = findStub(checks[c].first);
+		if(found < 0){
+			// The barriers are sorted: the last one in range is the furthest ahead, or the nearest behind
+			int best = -1;
+			for(unsigned int b = 0; b < barriers.size(); b++){
+				if(inRange(checks[c].first, barriers[b].first)){
+					best = b;
+				}
+			}
+			if(best < 0){
+				continue;
+			}
+			rtx_insn* label = AsmGen::emitCodeLabel(0, barriers[best].second, 0x00, true);
+			AsmGen::emitCall(label);
+			found = addStub(barriers[best].first, label);
+			placed++;
+		}
+		assigned[c] = stubs[found].label;
+		if(assigned[c] != codeLabel){
+			set_label_ref_label(checks[c].second, assigned[c]);
+			LABEL_NUSES(assigned[c])++;
+		}
+	}
+
+	// 3) Count the checks that still need a long branch, with the final placement
+	farAfter = 0;
+	endUsed = false;
+	for(unsigned int c = 0; c < checks.size(); c++){
+		for(unsigned int s = 0; s < stubs.size(); s++){
+			if(stubs[s].label == assigned[c]){
+				farAfter += !inRange(checks[c].first, stubs[s].address);
+			}
+		}
+		endUsed |= (assigned[c] == codeLabel);
+	}
+
+	// 4) Drop the stub at the end of the function if no check uses it
+	rtx_insn* endCall = NEXT_INSN(codeLabel);
+	if(!endUsed && (endCall != 0x00) && CALL_P(endCall)){
+		delete_insn(endCall);
+		delete_insn(codeLabel);
+	}
+	stubs.clear();
+	return placed;
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Function to find the reference to the label in the expression
+ * @param ref Set to the LABEL_REF
+ */
+bool ErrorStubs::referencesLabel(rtx expr, rtx_insn* label, rtx& ref){
+	if(expr == 0x00){
+		return false;
+	}
+	rtx_code exprCode = (rtx_code) expr->code;
+	if(exprCode == LABEL_REF){
+		ref = expr;
+		return label_ref_label(expr) == label;
+	}
+	const char* format = GET_RTX_FORMAT(exprCode);
+	for(int x = 0; x < GET_RTX_LENGTH(exprCode); x++){
+		if(format[x] == 'e'){
+			if(referencesLabel(XEXP(expr, x), label, ref)){
+				return true;
+			}
+		}
+		else if(format[x] == 'E'){
+			for(int i = 0; i < XVECLEN(expr, x); i++){
+				if(referencesLabel(XVECEXP(expr, x, i), label, ref)){
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Function to determine the offset of the branch of a check to a stub,
+ * relative to the PC of the check (its address + 4).
+ * The stubs placed between both move them further apart.
+ */
+int ErrorStubs::offset(unsigned int checkAddress, unsigned int stubAddress){
+	int between = 0;
+	for(unsigned int s = 0; s < stubs.size(); s++){
+		if(stubAddress > checkAddress){
+			between += (stubs[s].address > checkAddress) && (stubs[s].address < stubAddress);
+		}
+		else{
+			between += (stubs[s].address > stubAddress) && (stubs[s].address <= checkAddress);
+		}
+	}
+	if(stubAddress > checkAddress){
+		return (int) (stubAddress - checkAddress) - 4 + STUB_SIZE*between;
+	}
+	return -(int) (checkAddress - stubAddress) - 4 - STUB_SIZE*between;
+}
+
+/**
+ * Function to determine whether a check reaches the stub with a 16-bit conditional branch
+ */
+bool ErrorStubs::inRange(unsigned int checkAddress, unsigned int stubAddress){
+	int branchOffset = offset(checkAddress, stubAddress);
+	return (branchOffset >= -256 + RANGE_MARGIN) && (branchOffset <= 254 - RANGE_MARGIN);
+}
+
+/**
+ * Function to find a placed stub the check reaches with a 16-bit conditional branch
+ * @return The index of the stub, -1 if there is none
+ */
+int ErrorStubs::findStub(unsigned int checkAddress){
+	for(unsigned int s = 0; s < stubs.size(); s++){
+		if(inRange(checkAddress, stubs[s].address)){
+			return s;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Function to add a stub, keeping the stubs sorted on address
+ * @return The index of the stub
+ */
+int ErrorStubs::addStub(unsigned int address, rtx_insn* label){
+	ErrorStub stub;
+	stub.address = address;
+	stub.label = label;
+	unsigned int pos = 0;
+	while((pos < stubs.size()) && (stubs[pos].address <= address)){
+		pos++;
+	}
+	stubs.insert(stubs.begin() + pos, stub);
+	return pos;
+}
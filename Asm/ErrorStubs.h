@@ -0,0 +1,61 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * This is the header file of the ErrorStubs class.
+ *
+ * It contains the prototypes of the methods used to place extra error stubs
+ * (a label followed by BL CFED_Detected) in the current function, once all
+ * checks are inserted, so that every check reaches a stub with a 16-bit
+ * conditional branch (-256 to +254 bytes). Far checks otherwise need a 32-bit
+ * branch on ARMv7-M, and an inverted branch around a B on ARMv6-M.
+ *
+ * Stubs are only placed after a barrier, where no code falls through, so they
+ * never end up on the path of the original code. The checks are handled in
+ * order of address: a check without a stub in range gets a new stub at the
+ * furthest barrier ahead in range, or else at the nearest barrier behind it.
+ * The addresses are estimated with EncodingSize and a safety margin,
+ * the stub at the end of the function is removed if no check uses it any more.
+ */
+
+#ifndef ASM_ERRORSTUBS_H_
+#define ASM_ERRORSTUBS_H_
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Struct holding an error stub
+ * Contains:
+ * 	- The estimated address of the stub, without the stubs placed before it
+ * 	- The label of the stub
+ */
+struct ErrorStub{
+	unsigned int address;
+	rtx_insn* label;
+};
+
+class ErrorStubs{
+	public:
+		static unsigned int place(rtx_insn* codeLabel, unsigned int& farBefore, unsigned int& farAfter, bool& endUsed);
+
+	private:
+		static vector<ErrorStub> stubs;
+
+		static bool referencesLabel(rtx expr, rtx_insn* label, rtx& ref);
+		static int offset(unsigned int checkAddress, unsigned int stubAddress);
+		static bool inRange(unsigned int checkAddress, unsigned int stubAddress);
+		static int findStub(unsigned int checkAddress);
+		static int addStub(unsigned int address, rtx_insn* label);
+};
+
+
+#endif /* ASM_ERRORSTUBS_H_ */
@@ -11,13 +11,14 @@
 
 #include "InstrType.h"
 
+vector<InsnClassEntry> InstrType::cache;
+
 /**
  * Method to determine whether or not the provided
  * rtx_insn is a compare instruction
  */
 bool InstrType::isCompare(rtx_insn* expr){
-	rtx innerExpr = XEXP(expr, 3);
-	return findCode(innerExpr, COMPARE);
+	return (classify(expr).mask & CLASS_COMPARE) != 0;
 }
 
 /**
@@ -25,8 +26,7 @@ bool InstrType::isCompare(rtx_insn* expr){
  * rtx_insn is a conditionally executed instruction
  */
 bool InstrType::isCondExec(rtx_insn* expr){
-	rtx innerExpr = XEXP(expr, 3);
-	return findCode(innerExpr, COND_EXEC);
+	return (classify(expr).mask & CLASS_COND_EXEC) != 0;
 }
 
 /**
@@ -34,10 +34,7 @@ bool InstrType::isCondExec(rtx_insn* expr){
  * rtx_insn is a return instruction
  */
 bool InstrType::isReturn(rtx_insn* expr){
-	rtx innerExpr = XEXP(expr, 3);
-	bool ret =  findCode(innerExpr, RETURN);
-	bool simpRet = findCode(innerExpr, SIMPLE_RETURN);
-	return (ret || simpRet);
+	return (classify(expr).mask & CLASS_RETURN) != 0;
 }
 
 /**
@@ -63,14 +60,7 @@ bool InstrType::isExitBlock(basic_block bb){
  * rtx_insn is a use instruction (RTL syntax)
  */
 bool InstrType::isUse(rtx_insn* expr){
-    if (INSN_P(expr)){
-	    rtx innerExpr = XEXP(expr, 3);
-	    rtx_code exprCode = (rtx_code) innerExpr->code;
-	    return (exprCode == USE);
-    }
-    else{
-        return false;
-    }
+	return (classify(expr).mask & CLASS_USE) != 0;
 }
 
 /**
@@ -78,14 +68,7 @@ bool InstrType::isUse(rtx_insn* expr){
  * rtx_insn is an unspec instruction (RTL syntax)
  */
 bool InstrType::isUnspec(rtx_insn* expr){
-	if(INSN_P(expr)){
-		rtx innerExpr = XEXP(expr, 3);
-		rtx_code exprCode = (rtx_code) innerExpr->code;
-		return (exprCode == UNSPEC);
-	}
-	else{
-		return false;
-	}
+	return (classify(expr).mask & CLASS_UNSPEC) != 0;
 }
 
 /**
@@ -93,14 +76,7 @@ bool InstrType::isUnspec(rtx_insn* expr){
  * rtx_insn is a clobber instruction (RTL syntax)
  */
 bool InstrType::isClobber(rtx_insn* expr){
-	if(INSN_P(expr)){
-		rtx inner = XEXP(expr, 3);
-		rtx_code innerCode = (rtx_code) inner->code;
-		return (innerCode == CLOBBER);
-	}
-	else{
-		return false;
-	}
+	return (classify(expr).mask & CLASS_CLOBBER) != 0;
 }
 
 /**
@@ -108,14 +84,7 @@ bool InstrType::isClobber(rtx_insn* expr){
  * rtx_insn is a volatile unspec instruction (RTL syntax)
  */
 bool InstrType::isUnspecVolatile(rtx_insn* expr){
-	if(INSN_P(expr)){
-		rtx inner = XEXP(expr, 3);
-		rtx_code innerCode = (rtx_code) inner->code;
-		return (innerCode == UNSPEC_VOLATILE);
-	}
-	else{
-		return false;
-	}
+	return (classify(expr).mask & CLASS_UNSPEC_VOLATILE) != 0;
 }
 
 /**
@@ -123,13 +92,7 @@ bool InstrType::isUnspecVolatile(rtx_insn* expr){
  * rtx_insn is a conditional jump instruction
  */
 bool InstrType::isCondJump(rtx_insn* insn){
-	if(isReturn(insn)){
-		return false;
-	}
-	else{
-		rtx set = XEXP(insn, 3);
-		return (findCode(set, IF_THEN_ELSE) && JUMP_P(insn) );
-	}
+	return (classify(insn).mask & CLASS_COND_JUMP) != 0;
 }
 
 /**
@@ -137,11 +100,16 @@ bool InstrType::isCondJump(rtx_insn* insn){
  * rtx_insn is a compare-branch zero instruction
  */
 bool InstrType::isCBZ(rtx_insn* insn){
-	rtx_insn* innerExpr = insn;//XEXP(insn, 4);
-	bool isPar = findCode(innerExpr, PARALLEL);
-	bool isIfTE = findCode(innerExpr, IF_THEN_ELSE);
-	bool isConstIntZero = findConstIntWithNumber(innerExpr, 0);
-	return (isPar && isIfTE && isConstIntZero && JUMP_P(insn));
+	return (classify(insn).mask & CLASS_CBZ) != 0;
+}
+
+/**
+ * Method to determine whether or not the provided
+ * rtx_insn is a table jump (TBB, TBH or the ARMv6-M case helpers),
+ * followed by its jump table
+ */
+bool InstrType::isTableJump(rtx_insn* insn){
+	return (classify(insn).mask & CLASS_TABLE_JUMP) != 0;
 }
 
 /**
@@ -149,8 +117,26 @@ bool InstrType::isCBZ(rtx_insn* insn){
  * provided rtx_insn
  */
 rtx_code InstrType::getCondCode(rtx_insn* condExpr){
-	rtx set = XEXP(condExpr, 3);
-	return getConditionalCode(set, IF_THEN_ELSE);
+	return classify(condExpr).condCode;
+}
+
+/**
+ * Method to drop the cached classification of the provided
+ * rtx_insn. Must be called when an insn is modified in place.
+ */
+void InstrType::invalidate(rtx_insn* insn){
+	unsigned int uid = INSN_UID(insn);
+	if(uid < cache.size()){
+		cache[uid].insn = 0x00;
+	}
+}
+
+/**
+ * Method to drop all cached classifications,
+ * e.g. when starting on a new function
+ */
+void InstrType::clearCache(){
+	cache.clear();
 }
 
 /**
@@ -198,6 +184,78 @@ rtx_code InstrType::findContraryConditionalCode(enum rtx_code condition){
 
 // ----------------------- Private Section -------------------------- \\
 
+/**
+ * Method to get the classification of the provided rtx_insn.
+ * Computed on first use and cached by INSN_UID. An entry is recomputed
+ * when the UID now belongs to another insn or the pattern was replaced.
+ */
+InsnClassEntry InstrType::classify(rtx_insn* insn){
+	unsigned int uid = INSN_UID(insn);
+	if(uid >= cache.size()){
+		InsnClassEntry empty = {};
+		unsigned int newSize = (uid < (unsigned int)get_max_uid()) ? get_max_uid() : uid+1;
+		cache.resize(newSize*2, empty);
+	}
+	InsnClassEntry& entry = cache[uid];
+	if(entry.insn != insn || entry.pattern != XEXP(insn, 3)){
+		computeClass(insn, entry);
+	}
+	return entry;
+}
+
+/**
+ * Method to compute the classification of the provided rtx_insn
+ */
+void InstrType::computeClass(rtx_insn* insn, InsnClassEntry& entry){
+	rtx innerExpr = XEXP(insn, 3);
+	unsigned int mask = 0;
+	if(findCode(innerExpr, COMPARE)){
+		mask |= CLASS_COMPARE;
+	}
+	if(findCode(innerExpr, COND_EXEC)){
+		mask |= CLASS_COND_EXEC;
+	}
+	if(findCode(innerExpr, RETURN) || findCode(innerExpr, SIMPLE_RETURN)){
+		mask |= CLASS_RETURN;
+	}
+	if(JUMP_P(insn)){
+		// The Thumb-2 table jump includes the range check, it is not a conditional jump
+		if(tablejump_p(insn, NULL, NULL)){
+			mask |= CLASS_TABLE_JUMP;
+		}
+		else{
+			if(!(mask & CLASS_RETURN) && findCode(innerExpr, IF_THEN_ELSE)){
+				mask |= CLASS_COND_JUMP;
+			}
+			if(findCode(insn, PARALLEL) && findCode(insn, IF_THEN_ELSE) && findConstIntWithNumber(insn, 0)){
+				mask |= CLASS_CBZ;
+			}
+		}
+	}
+	if(INSN_P(insn)){
+		switch(GET_CODE(innerExpr)){
+			case USE:
+				mask |= CLASS_USE;
+				break;
+			case CLOBBER:
+				mask |= CLASS_CLOBBER;
+				break;
+			case UNSPEC:
+				mask |= CLASS_UNSPEC;
+				break;
+			case UNSPEC_VOLATILE:
+				mask |= CLASS_UNSPEC_VOLATILE;
+				break;
+			default:
+				break;
+		}
+	}
+	entry.insn = insn;
+	entry.pattern = innerExpr;
+	entry.mask = mask;
+	entry.condCode = getConditionalCode(innerExpr, IF_THEN_ELSE);
+}
+
 /**
  * Method to find the provided rtx_code in the given
  * rtx. Is a recursive method to make sure all fields of
@@ -226,8 +284,8 @@ bool InstrType::findCode(rtx expr, rtx_code code){
 				}
 			}
 			else if(format[x] == 'E'){						// Test if a Vector
-				for(int i=0; i<XVECLEN(expr,0);i++){		// Loop over all expressions in the vector
-					rtx subExpr = XVECEXP(expr, 0, i);		// Get the expression
+				for(int i=0; i<XVECLEN(expr,x);i++){		// Loop over all expressions in the vector
+					rtx subExpr = XVECEXP(expr, x, i);		// Get the expression
 					if(findCode(subExpr, code)){			// Recursive call to this function
 						return true;
 					}
@@ -267,8 +325,8 @@ bool InstrType::findConstIntWithNumber(rtx expr, unsigned int number){
 				}
 			}
 			else if(format[x] == 'E'){						// Test if a Vector
-				for(int i=0; i<XVECLEN(expr,0);i++){		// Loop over all expressions in the vector
-					rtx subExpr = XVECEXP(expr, 0, i);		// Get the expression
+				for(int i=0; i<XVECLEN(expr,x);i++){		// Loop over all expressions in the vector
+					rtx subExpr = XVECEXP(expr, x, i);		// Get the expression
 					if(findConstIntWithNumber(subExpr, number)){			// Recursive call to this function
 						return true;
 					}
@@ -305,8 +363,8 @@ rtx_code InstrType::getConditionalCode(rtx expr, rtx_code code){
 					}
 				}
 				else if(format[x] == 'E'){						// Test if a Vector
-					for(int i=0; i<XVECLEN(expr,0);i++){		// Loop over all expressions in the vector
-						rtx subExpr = XVECEXP(expr, 0, i);		// Get the expression
+					for(int i=0; i<XVECLEN(expr,x);i++){		// Loop over all expressions in the vector
+						rtx subExpr = XVECEXP(expr, x, i);		// Get the expression
 						rtx_code condCode = getConditionalCode(subExpr, code);
 						if(condCode != -1){			// Recursive call to this function
 							return condCode;
@@ -18,6 +18,37 @@
 #include <basic-block.h>
 #include <rtl.h>
 
+#include <vector>
+
+using namespace std;
+
+/**
+ * Properties of an rtx_insn, computed once per insn and cached by InstrType
+ */
+enum InsnClass{
+	CLASS_COMPARE = 1 << 0,
+	CLASS_COND_EXEC = 1 << 1,
+	CLASS_RETURN = 1 << 2,
+	CLASS_COND_JUMP = 1 << 3,
+	CLASS_CBZ = 1 << 4,
+	CLASS_USE = 1 << 5,
+	CLASS_CLOBBER = 1 << 6,
+	CLASS_UNSPEC = 1 << 7,
+	CLASS_UNSPEC_VOLATILE = 1 << 8,
+	CLASS_TABLE_JUMP = 1 << 9
+};
+
+/**
+ * Struct holding the cached classification of one rtx_insn
+ * The insn and its pattern are kept to detect reused UIDs and replaced patterns
+ */
+struct InsnClassEntry{
+	rtx_insn* insn;
+	rtx pattern;
+	unsigned int mask;
+	rtx_code condCode;
+};
+
 class InstrType{
 	public:
 		static bool isCompare(rtx_insn* expr);
@@ -34,8 +65,16 @@ class InstrType{
 		static rtx_code findContraryConditionalCode(enum rtx_code condition);
 
 		static bool isCBZ(rtx_insn* insn);
+		static bool isTableJump(rtx_insn* insn);
+
+		static void invalidate(rtx_insn* insn);
+		static void clearCache();
 
 	private:
+		static vector<InsnClassEntry> cache;
+		static InsnClassEntry classify(rtx_insn* insn);
+		static void computeClass(rtx_insn* insn, InsnClassEntry& entry);
+
 		static bool findCode(rtx expr, rtx_code code);
 		static bool findConstIntWithNumber(rtx expr, unsigned int number);
 		static rtx_code getConditionalCode(rtx expr, rtx_code cond);
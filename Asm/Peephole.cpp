@@ -0,0 +1,318 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+#include <emit-rtl.h>
+
+#include "Peephole.h"
+#include "InstrType.h"
+#include "ArmISA_Functions.h"
+
+int Peephole::firstUID = 0;
+vector<unsigned int> Peephole::regs;
+unsigned int Peephole::removed = 0;
+
+/**
+ * Function to fold the inserted instructions of the current function.
+ * @param firstUID The UID of the first instruction inserted by the technique
+ * @param regs The signature registers of the technique
+ * @return The number of removed instructions
+ */
+unsigned int Peephole::optimize(int firstUID, vector<unsigned int>& regs){
+	Peephole::firstUID = firstUID;
+	Peephole::regs = regs;
+	Peephole::removed = 0;
+
+	vector<rtx_insn*> blockInsns;
+	vector<rtx_insn*> window;
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		// Collect the insns first, the basic block changes while folding
+		blockInsns.clear();
+		rtx_insn* insn;
+		FOR_BB_INSNS(bb, insn){
+			if(LABEL_P(insn) || NONDEBUG_INSN_P(insn)){
+				blockInsns.push_back(insn);
+			}
+		}
+
+		// The window holds the kept real insns since the last label
+		window.clear();
+		for(unsigned int i = 0; i < blockInsns.size(); i++){
+			insn = blockInsns[i];
+			if(LABEL_P(insn)){
+				window.clear();
+			}
+			else if(window.empty() || !isInserted(insn) || !isInserted(window.back()) || !fold(insn, window)){
+				window.push_back(insn);
+			}
+		}
+	}
+	return removed;
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Function to fold the provided insn with the previous insns in the window,
+ * which is updated accordingly.
+ * @return true if the provided insn was removed
+ */
+bool Peephole::fold(rtx_insn* insn, vector<rtx_insn*>& window){
+	rtx_insn* prev = window.back();
+	rtx_code prevCode, code;
+	unsigned int prevReg, reg;
+	int prevValue, value;
+
+	// ADD followed by ADD, EOR followed by EOR
+	if(matchUpdate(prev, prevCode, prevReg, prevValue) && matchUpdate(insn, code, reg, value) &&
+			(prevReg == reg) && (prevCode == code)){
+		int folded = (code == PLUS) ? (prevValue + value) : (prevValue ^ value);
+		if(folded == 0){
+			remove(insn);
+			remove(prev);
+			window.pop_back();
+			return true;
+		}
+		if((code == PLUS) ? addImmediateOK(folded) : xorImmediateOK(folded)){
+			replaceSource(prev, code, reg, folded);
+			remove(insn);
+			return true;
+		}
+	}
+
+	// MOV followed by ADD or EOR
+	if(matchMov(prev, prevReg, prevValue) && matchUpdate(insn, code, reg, value) && (prevReg == reg)){
+		int folded = (code == PLUS) ? (prevValue + value) : (prevValue ^ value);
+		if(movImmediateOK(folded)){
+			replaceSource(prev, CONST_INT, reg, folded);
+			remove(insn);
+			return true;
+		}
+	}
+
+	// Value overwritten by a MOV
+	if(matchMov(insn, reg, value) && writesSignatureReg(prev, prevReg) && (prevReg == reg)){
+		remove(prev);
+		window.pop_back();
+		if(!window.empty() && isInserted(window.back())){
+			return fold(insn, window);
+		}
+		return false;
+	}
+
+	// Compare repeating the previous compare, with only a branch in between
+	if(matchCompare(insn) && matchCondBranch(prev) && (window.size() >= 2)){
+		rtx_insn* prevCompare = window[window.size()-2];
+		if(isInserted(prevCompare) && rtx_equal_p(PATTERN(prevCompare), PATTERN(insn))){
+			remove(insn);
+			return true;
+		}
+	}
+
+	// Conditional branch repeating the previous conditional branch
+	if(matchCondBranch(insn) && matchCondBranch(prev) && rtx_equal_p(PATTERN(prev), PATTERN(insn))){
+		remove(insn);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Function to determine whether or not the insn was inserted by the technique
+ */
+bool Peephole::isInserted(rtx_insn* insn){
+	return INSN_UID(insn) >= firstUID;
+}
+
+/**
+ * Function to determine whether or not the expression is a signature register
+ */
+bool Peephole::isSignatureReg(rtx expr){
+	if(!REG_P(expr)){
+		return false;
+	}
+	for(unsigned int i = 0; i < regs.size(); i++){
+		if(REGNO(expr) == regs[i]){
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Matches: (set (reg) (<code> (reg) (const_int))) on a signature register
+ */
+bool Peephole::matchRegConst(rtx_insn* insn, rtx_code code, unsigned int& reg, int& value){
+	rtx pattern = PATTERN(insn);
+	if(GET_CODE(pattern) != SET || !isSignatureReg(SET_DEST(pattern))){
+		return false;
+	}
+	rtx src = SET_SRC(pattern);
+	if(GET_CODE(src) != code || !REG_P(XEXP(src, 0)) || (REGNO(XEXP(src, 0)) != REGNO(SET_DEST(pattern))) || !CONST_INT_P(XEXP(src, 1))){
+		return false;
+	}
+	reg = REGNO(SET_DEST(pattern));
+	value = INTVAL(XEXP(src, 1));
+	return true;
+}
+
+/**
+ * Matches ADD, SUB (as an ADD of the negated value) and EOR with a constant on a signature register
+ */
+bool Peephole::matchUpdate(rtx_insn* insn, rtx_code& code, unsigned int& reg, int& value){
+	if(matchRegConst(insn, PLUS, reg, value)){
+		code = PLUS;
+		return true;
+	}
+	if(matchRegConst(insn, MINUS, reg, value)){
+		code = PLUS;
+		value = -value;
+		return true;
+	}
+	if(matchRegConst(insn, XOR, reg, value)){
+		code = XOR;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Matches: MOV reg,#value on a signature register
+ */
+bool Peephole::matchMov(rtx_insn* insn, unsigned int& reg, int& value){
+	rtx pattern = PATTERN(insn);
+	if(GET_CODE(pattern) != SET || !isSignatureReg(SET_DEST(pattern)) || !CONST_INT_P(SET_SRC(pattern))){
+		return false;
+	}
+	reg = REGNO(SET_DEST(pattern));
+	value = INTVAL(SET_SRC(pattern));
+	return true;
+}
+
+/**
+ * Matches: CMP reg,... on a signature register
+ */
+bool Peephole::matchCompare(rtx_insn* insn){
+	rtx pattern = PATTERN(insn);
+	if(GET_CODE(pattern) != SET || GET_CODE(SET_SRC(pattern)) != COMPARE){
+		return false;
+	}
+	return isSignatureReg(XEXP(SET_SRC(pattern), 0));
+}
+
+/**
+ * Matches: (set (pc) (if_then_else ...))
+ * The inserted checks are plain insns, not jump insns, so they are matched on their pattern
+ */
+bool Peephole::matchCondBranch(rtx_insn* insn){
+	rtx pattern = PATTERN(insn);
+	return (GET_CODE(pattern) == SET) && (GET_CODE(SET_DEST(pattern)) == PC) && (GET_CODE(SET_SRC(pattern)) == IF_THEN_ELSE);
+}
+
+/**
+ * Function to determine whether the insn only computes a new value
+ * for a signature register, without any other effect
+ */
+bool Peephole::writesSignatureReg(rtx_insn* insn, unsigned int& reg){
+	rtx pattern = PATTERN(insn);
+	if(!NONJUMP_INSN_P(insn) || GET_CODE(pattern) != SET || !isSignatureReg(SET_DEST(pattern))){
+		return false;
+	}
+	switch(GET_CODE(SET_SRC(pattern))){
+		case CONST_INT:
+		case REG:
+		case PLUS:
+		case MINUS:
+		case XOR:
+		case AND:
+		case IOR:
+			reg = REGNO(SET_DEST(pattern));
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Function to replace the source of the insn by (<code> (reg) (const_int value)),
+ * or by (const_int value) for code CONST_INT
+ */
+void Peephole::replaceSource(rtx_insn* insn, rtx_code code, unsigned int reg, int value){
+	rtx src;
+	if(code == CONST_INT){
+		src = GEN_INT(value);
+	}
+	else if(code == PLUS){
+		src = gen_rtx_PLUS(SImode, gen_rtx_REG(SImode, reg), GEN_INT(value));
+	}
+	else{
+		src = gen_rtx_XOR(SImode, gen_rtx_REG(SImode, reg), GEN_INT(value));
+	}
+	SET_SRC(PATTERN(insn)) = src;
+	INSN_CODE(insn) = -1;
+	InstrType::invalidate(insn);
+}
+
+/**
+ * Function to remove the insn from the function
+ */
+void Peephole::remove(rtx_insn* insn){
+	InstrType::invalidate(insn);
+	delete_insn(insn);
+	removed++;
+}
+
+/**
+ * Function to determine whether the value can be added to a register with a single instruction
+ */
+bool Peephole::addImmediateOK(int value){
+	if(ARM_ISA::getISAtarget(arm_cpu_option) == ARMv7M){
+		return (value >= -4095) && (value <= 4095);
+	}
+	return (value >= -255) && (value <= 255);
+}
+
+/**
+ * Function to determine whether the value can be XORed with a register with a single instruction
+ */
+bool Peephole::xorImmediateOK(int value){
+	if(ARM_ISA::getISAtarget(arm_cpu_option) == ARMv7M){
+		return isModifiedImmediate(value);
+	}
+	return false;
+}
+
+/**
+ * Function to determine whether the value can be moved into a register with a single instruction
+ */
+bool Peephole::movImmediateOK(int value){
+	if(ARM_ISA::getISAtarget(arm_cpu_option) == ARMv7M){
+		return ((value >= 0) && (value <= 0xFFFF)) || isModifiedImmediate(value) || isModifiedImmediate(~value);
+	}
+	return (value >= 0) && (value <= 255);
+}
+
+/**
+ * Function to determine whether the value is a Thumb-2 modified immediate constant:
+ * 0x000000XY, 0x00XY00XY, 0xXY00XY00, 0xXYXYXYXY or 1bcdefgh rotated right by 8 to 31 bits
+ */
+bool Peephole::isModifiedImmediate(unsigned int value){
+	unsigned int low = value & 0xFF;
+	unsigned int high = (value >> 8) & 0xFF;
+	if((value <= 0xFF) || (value == (low | (low << 16))) || (value == ((high << 8) | (high << 24))) || (value == low * 0x01010101)){
+		return true;
+	}
+	for(unsigned int rotation = 8; rotation < 32; rotation++){
+		unsigned int unrotated = (value << rotation) | (value >> (32 - rotation));
+		if((unrotated >= 0x80) && (unrotated <= 0xFF)){
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,62 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * This is the header file of the Peephole class.
+ *
+ * It contains the prototypes of the methods used to clean up the
+ * instructions inserted by a technique, once all of them are inserted.
+ * Only pairs of adjacent inserted instructions of the same basic block
+ * that work on the signature registers are considered:
+ * 	- ADD/SUB reg,#a followed by ADD/SUB reg,#b becomes ADD reg,#(a+b)
+ * 	- EOR reg,#a followed by EOR reg,#b becomes EOR reg,#(a^b)
+ * 	- MOV reg,#a followed by ADD/SUB/EOR reg,#b becomes MOV reg,#(a op b)
+ * 	- a value of reg overwritten by the next MOV reg,#b is removed
+ * 	- a compare (and branch) repeating the previous compare and branch is removed
+ * A fold is only done if the new constant can be encoded by the target.
+ */
+
+#ifndef ASM_PEEPHOLE_H_
+#define ASM_PEEPHOLE_H_
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include <vector>
+
+using namespace std;
+
+class Peephole{
+	public:
+		static unsigned int optimize(int firstUID, vector<unsigned int>& regs);
+
+	private:
+		static int firstUID;
+		static vector<unsigned int> regs;
+		static unsigned int removed;
+
+		static bool isInserted(rtx_insn* insn);
+		static bool isSignatureReg(rtx expr);
+		static bool matchRegConst(rtx_insn* insn, rtx_code code, unsigned int& reg, int& value);
+		static bool matchUpdate(rtx_insn* insn, rtx_code& code, unsigned int& reg, int& value);
+		static bool matchMov(rtx_insn* insn, unsigned int& reg, int& value);
+		static bool matchCompare(rtx_insn* insn);
+		static bool matchCondBranch(rtx_insn* insn);
+		static bool writesSignatureReg(rtx_insn* insn, unsigned int& reg);
+
+		static bool fold(rtx_insn* insn, vector<rtx_insn*>& window);
+		static void replaceSource(rtx_insn* insn, rtx_code code, unsigned int reg, int value);
+		static void remove(rtx_insn* insn);
+
+		static bool addImmediateOK(int value);
+		static bool xorImmediateOK(int value);
+		static bool movImmediateOK(int value);
+		static bool isModifiedImmediate(unsigned int value);
+};
+
+
+#endif /* ASM_PEEPHOLE_H_ */
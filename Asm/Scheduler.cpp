@@ -0,0 +1,363 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+#include <emit-rtl.h>
+
+#include "Scheduler.h"
+#include "InstrType.h"
+
+int Scheduler::firstUID = 0;
+unsigned int Scheduler::issueWidth = 1;
+unsigned int Scheduler::moved = 0;
+vector<SchedNode> Scheduler::nodes;
+
+/**
+ * Function to reschedule the inserted instructions of the current function.
+ * Uses a lightweight in-order pipeline model: the Cortex-M7 issues two
+ * instructions per cycle, the other cores one, and a loaded value can only
+ * be used two cycles after the load, all other results one cycle later.
+ * @param firstUID The UID of the first instruction inserted by the technique
+ * @param cyclesSaved Incremented with the number of cycles the model saves
+ * @return The number of moved instructions
+ */
+unsigned int Scheduler::schedule(int firstUID, unsigned int& cyclesSaved){
+	Scheduler::firstUID = firstUID;
+	Scheduler::issueWidth = (arm_cpu_option == TARGET_CPU_cortexm7) ? 2 : 1;
+	Scheduler::moved = 0;
+
+	vector<rtx_insn*> blockInsns;
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		// Collect the insns first, the basic block changes while scheduling
+		blockInsns.clear();
+		rtx_insn* insn;
+		FOR_BB_INSNS(bb, insn){
+			blockInsns.push_back(insn);
+		}
+
+		// The nodes hold the current run of plain insns
+		nodes.clear();
+		for(unsigned int i = 0; i < blockInsns.size(); i++){
+			insn = blockInsns[i];
+			SchedNode node;
+			if(NOTE_P(insn) || DEBUG_INSN_P(insn)){
+				// Notes and debug insns stay after the insn before them, they do not end the run
+				if(!nodes.empty()){
+					nodes.back().followers.push_back(insn);
+				}
+			}
+			else if(NONJUMP_INSN_P(insn) && buildNode(insn, node)){
+				nodes.push_back(node);
+			}
+			else{
+				scheduleRun(bb, cyclesSaved);
+				nodes.clear();
+			}
+		}
+		scheduleRun(bb, cyclesSaved);
+	}
+	nodes.clear();
+	return moved;
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Function to schedule the run of consecutive plain instructions of the basic block held by the nodes.
+ * Runs without inserted or without original instructions are left as they are.
+ */
+void Scheduler::scheduleRun(basic_block bb, unsigned int& cyclesSaved){
+	bool hasInserted = false;
+	bool hasOriginal = false;
+	for(unsigned int i = 0; i < nodes.size(); i++){
+		if(INSN_UID(nodes[i].insn) >= firstUID){
+			hasInserted = true;
+		}
+		else{
+			hasOriginal = true;
+		}
+	}
+	if(!hasInserted || !hasOriginal || (PREV_INSN(nodes.front().insn) == 0x00)){
+		return;
+	}
+	buildDependencies();
+
+	vector<unsigned int> original(nodes.size());
+	for(unsigned int i = 0; i < original.size(); i++){
+		original[i] = i;
+	}
+	vector<unsigned int> order;
+	listSchedule(order);
+
+	unsigned int before = simulate(original);
+	unsigned int after = simulate(order);
+	if(after < before){
+		reorder(order, bb);
+		cyclesSaved += before - after;
+	}
+}
+
+/**
+ * Function to fill in the registers and memory the insn reads and writes.
+ * @return false if the insn must not be moved
+ */
+bool Scheduler::buildNode(rtx_insn* insn, SchedNode& node){
+	if(RTX_FRAME_RELATED_P(insn) || InstrType::isCondExec(insn) || InstrType::isUse(insn) ||
+			InstrType::isClobber(insn) || InstrType::isUnspecVolatile(insn)){
+		return false;
+	}
+	node.insn = insn;
+	node.defs.reset();
+	node.uses.reset();
+	node.readsMem = false;
+	node.writesMem = false;
+	node.priority = 0;
+	node.preds.clear();
+	node.followers.clear();
+	if(!collect(PATTERN(insn), node, false)){
+		return false;
+	}
+	node.latency = node.readsMem ? 2 : 1;
+	return true;
+}
+
+/**
+ * Function to collect the registers and memory accessed by the expression.
+ * @param isDest Whether the expression is written instead of read
+ * @return false if the expression contains something that must not be moved,
+ * such as inline assembly, a volatile memory access or a branch
+ */
+bool Scheduler::collect(rtx expr, SchedNode& node, bool isDest){
+	if(expr == 0x00){
+		return true;
+	}
+
+	rtx_code exprCode = (rtx_code) expr->code;
+	switch(exprCode){
+		case ASM_OPERANDS:
+		case ASM_INPUT:
+		case UNSPEC_VOLATILE:
+		case TRAP_IF:
+		case LABEL_REF:
+			return false;
+		case PC:
+			// The inserted checks are plain insns that set the pc, they end the run
+			return !isDest;
+		case REG:
+			markRegs(expr, isDest ? node.defs : node.uses);
+			return true;
+		case SET:
+			return collect(SET_DEST(expr), node, true) && collect(SET_SRC(expr), node, false);
+		case CLOBBER:
+			return collect(XEXP(expr, 0), node, true);
+		case MEM:
+			if(MEM_VOLATILE_P(expr)){
+				return false;
+			}
+			if(isDest){
+				node.writesMem = true;
+			}
+			else{
+				node.readsMem = true;
+			}
+			return collect(XEXP(expr, 0), node, false);
+		case SUBREG:
+		case STRICT_LOW_PART:
+		case ZERO_EXTRACT:
+			// A partial write keeps the rest of the register
+			if(isDest && !collect(XEXP(expr, 0), node, true)){
+				return false;
+			}
+			break;
+		default:
+			if(GET_RTX_CLASS(exprCode) == RTX_AUTOINC){
+				// The address register is read and written
+				markRegs(XEXP(expr, 0), node.defs);
+			}
+			break;
+	}
+
+	const char* format = GET_RTX_FORMAT(exprCode);
+	for(int x = 0; x < GET_RTX_LENGTH(exprCode); x++){
+		if(format[x] == 'e'){
+			if(!collect(XEXP(expr, x), node, false)){
+				return false;
+			}
+		}
+		else if(format[x] == 'E'){
+			for(int i = 0; i < XVECLEN(expr, x); i++){
+				if(!collect(XVECEXP(expr, x, i), node, false)){
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Function to mark all hard registers covered by the register expression
+ */
+void Scheduler::markRegs(rtx reg, bitset<FIRST_PSEUDO_REGISTER>& regs){
+	if(!REG_P(reg)){
+		return;
+	}
+	for(unsigned int regNo = REGNO(reg); (regNo < END_REGNO(reg)) && (regNo < FIRST_PSEUDO_REGISTER); regNo++){
+		regs.set(regNo);
+	}
+}
+
+/**
+ * Function to determine the predecessors of each node and the priority of each node.
+ * A read after a write waits for the latency of the write,
+ * any other dependency only keeps the order.
+ */
+void Scheduler::buildDependencies(){
+	for(unsigned int j = 0; j < nodes.size(); j++){
+		SchedNode& later = nodes[j];
+		for(unsigned int i = 0; i < j; i++){
+			SchedNode& earlier = nodes[i];
+			bool trueDep = (earlier.defs & later.uses).any() || (earlier.writesMem && later.readsMem);
+			bool orderDep = (earlier.defs & later.defs).any() || (earlier.uses & later.defs).any() ||
+					(earlier.writesMem && later.writesMem) || (earlier.readsMem && later.writesMem);
+			if(trueDep){
+				later.preds.push_back(make_pair(i, earlier.latency));
+			}
+			else if(orderDep){
+				later.preds.push_back(make_pair(i, 0));
+			}
+		}
+	}
+
+	// Longest latency path to the end of the run, successors come later in the run
+	for(unsigned int i = 0; i < nodes.size(); i++){
+		nodes[i].priority = nodes[i].latency;
+	}
+	for(unsigned int j = nodes.size(); j-- > 0; ){
+		for(unsigned int p = 0; p < nodes[j].preds.size(); p++){
+			SchedNode& pred = nodes[nodes[j].preds[p].first];
+			unsigned int path = nodes[j].preds[p].second + nodes[j].priority;
+			if(path > pred.priority){
+				pred.priority = path;
+			}
+		}
+	}
+}
+
+/**
+ * Function to determine the number of cycles needed to issue the nodes
+ * in the provided order with the pipeline model, until all results are available
+ */
+unsigned int Scheduler::simulate(vector<unsigned int>& order){
+	vector<unsigned int> issue(nodes.size(), 0);
+	unsigned int cycle = 0;
+	unsigned int issued = 0;
+	unsigned int finished = 0;
+	for(unsigned int k = 0; k < order.size(); k++){
+		SchedNode& node = nodes[order[k]];
+		unsigned int start = cycle;
+		for(unsigned int p = 0; p < node.preds.size(); p++){
+			start = max(start, issue[node.preds[p].first] + node.preds[p].second);
+		}
+		if((issued == issueWidth) && (start == cycle)){
+			start++;
+		}
+		if(start > cycle){
+			cycle = start;
+			issued = 0;
+		}
+		issue[order[k]] = cycle;
+		issued++;
+		finished = max(finished, cycle + node.latency);
+	}
+	return finished;
+}
+
+/**
+ * Function to list schedule the nodes: each time the ready node that can
+ * issue first is taken, the one with the longest path to the end of the run
+ * on a tie, and the one that came first in the run after that.
+ */
+void Scheduler::listSchedule(vector<unsigned int>& order){
+	vector<bool> done(nodes.size(), false);
+	vector<unsigned int> issue(nodes.size(), 0);
+	unsigned int cycle = 0;
+	unsigned int issued = 0;
+	order.clear();
+	while(order.size() < nodes.size()){
+		int best = -1;
+		unsigned int bestStart = 0;
+		for(unsigned int i = 0; i < nodes.size(); i++){
+			if(done[i]){
+				continue;
+			}
+			bool ready = true;
+			unsigned int start = cycle;
+			for(unsigned int p = 0; p < nodes[i].preds.size(); p++){
+				if(!done[nodes[i].preds[p].first]){
+					ready = false;
+					break;
+				}
+				start = max(start, issue[nodes[i].preds[p].first] + nodes[i].preds[p].second);
+			}
+			if(!ready){
+				continue;
+			}
+			if((issued == issueWidth) && (start == cycle)){
+				start++;
+			}
+			if((best < 0) || (start < bestStart) || ((start == bestStart) && (nodes[i].priority > nodes[best].priority))){
+				best = i;
+				bestStart = start;
+			}
+		}
+		if(bestStart > cycle){
+			cycle = bestStart;
+			issued = 0;
+		}
+		issue[best] = cycle;
+		issued++;
+		done[best] = true;
+		order.push_back(best);
+	}
+}
+
+/**
+ * Function to put the insns of the run in the provided order,
+ * each one together with the notes and debug insns that follow it
+ */
+void Scheduler::reorder(vector<unsigned int>& order, basic_block bb){
+	bool isHead = (nodes.front().insn == BB_HEAD(bb));
+	bool isEnd = (lastOf(nodes.back()) == BB_END(bb));
+	rtx_insn* prev = PREV_INSN(nodes.front().insn);
+	for(unsigned int k = 0; k < order.size(); k++){
+		rtx_insn* insn = nodes[order[k]].insn;
+		rtx_insn* last = lastOf(nodes[order[k]]);
+		if(PREV_INSN(insn) != prev){
+			reorder_insns_nobb(insn, last, prev);
+		}
+		if(order[k] != k){
+			moved++;
+		}
+		prev = last;
+	}
+	if(isHead){
+		BB_HEAD(bb) = nodes[order.front()].insn;
+	}
+	if(isEnd){
+		BB_END(bb) = prev;
+	}
+}
+
+/**
+ * Function to find the last insn of the node: its last follower, or the insn itself
+ */
+rtx_insn* Scheduler::lastOf(SchedNode& node){
+	return node.followers.empty() ? node.insn : node.followers.back();
+}
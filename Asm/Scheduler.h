@@ -0,0 +1,84 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * This is the header file of the Scheduler class.
+ *
+ * It contains the prototypes of the methods used to reschedule the
+ * instructions inserted by a technique among the original instructions,
+ * once all of them are inserted. The plugin runs after sched2, so without
+ * it the inserted instructions form dependent chains next to code that was
+ * already scheduled.
+ *
+ * Each run of plain instructions of a basic block that contains inserted
+ * instructions is list scheduled on its own. Labels, jumps (including the
+ * inserted checks, which are plain insns setting the pc), calls, uses,
+ * conditionally executed, frame related and volatile instructions end a run
+ * and are never moved. Notes and debug insns do not end a run, they move
+ * along with the instruction before them, so the generated code does not
+ * depend on -g. The dependencies on all hard registers, including
+ * the flags, and on memory are respected. A run is only reordered if the
+ * pipeline model predicts fewer cycles for it.
+ */
+
+#ifndef ASM_SCHEDULER_H_
+#define ASM_SCHEDULER_H_
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include <bitset>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Struct holding one instruction of the run being scheduled
+ * Contains:
+ * 	- The instruction
+ * 	- The hard registers it writes and reads, the flags included
+ * 	- Whether or not it reads or writes memory
+ * 	- The number of cycles before its result can be used
+ * 	- The longest latency path from it to the end of the run
+ * 	- Its predecessors in the run, with the latency of each dependency
+ * 	- The notes and debug insns that follow it, moved along with it
+ */
+struct SchedNode{
+	rtx_insn* insn;
+	bitset<FIRST_PSEUDO_REGISTER> defs;
+	bitset<FIRST_PSEUDO_REGISTER> uses;
+	bool readsMem;
+	bool writesMem;
+	unsigned int latency;
+	unsigned int priority;
+	vector<pair<unsigned int, unsigned int> > preds;
+	vector<rtx_insn*> followers;
+};
+
+class Scheduler{
+	public:
+		static unsigned int schedule(int firstUID, unsigned int& cyclesSaved);
+
+	private:
+		static int firstUID;
+		static unsigned int issueWidth;
+		static unsigned int moved;
+		static vector<SchedNode> nodes;
+
+		static void scheduleRun(basic_block bb, unsigned int& cyclesSaved);
+		static bool buildNode(rtx_insn* insn, SchedNode& node);
+		static bool collect(rtx expr, SchedNode& node, bool isDest);
+		static void markRegs(rtx reg, bitset<FIRST_PSEUDO_REGISTER>& regs);
+		static void buildDependencies();
+		static unsigned int simulate(vector<unsigned int>& order);
+		static void listSchedule(vector<unsigned int>& order);
+		static void reorder(vector<unsigned int>& order, basic_block bb);
+		static rtx_insn* lastOf(SchedNode& node);
+};
+
+
+#endif /* ASM_SCHEDULER_H_ */
@@ -11,6 +11,7 @@
 
 #include "UpdatePoint.h"
 #include "InstrType.h"
+#include "BlockSummary.h"
 
 /**
  * Function that returns the first real INSN of
@@ -18,6 +19,9 @@
  * (No Debug or Note insn)
  */
 rtx_insn* UpdatePoint::firstRealINSN(basic_block bb){
+	if(BlockSummary::isBuilt()){
+		return BlockSummary::first(bb);
+	}
 	rtx_insn* next = BB_HEAD(bb);
 	while(!NONDEBUG_INSN_P(next)){
 		next = NEXT_INSN(next);
@@ -31,8 +35,13 @@ rtx_insn* UpdatePoint::firstRealINSN(basic_block bb){
  * (No Debug or Note insn)
  * To insert instructions in the middle of the basic block
  * attach them AFTER this INSN
+ * When the block summary is available, this is the middle INSN
+ * of the original instructions of the basic block.
  */
 rtx_insn* UpdatePoint::middleRealINSN(basic_block bb){
+	if(BlockSummary::isBuilt()){
+		return BlockSummary::middle(bb);
+	}
 	// Learn how many INSNs this block contains
 	unsigned int totalINSN = countInsnBB(bb);
 	// Find the middle INSN
@@ -67,6 +76,9 @@ rtx_insn* UpdatePoint::middleRealINSN(basic_block bb){
  * (No Debug or Note insn)
  */
 rtx_insn* UpdatePoint::lastRealINSN(basic_block bb){
+	if(BlockSummary::isBuilt()){
+		return BlockSummary::last(bb);
+	}
 	rtx_insn* lastInsn = BB_END(bb);
 	while(!NONDEBUG_INSN_P(lastInsn)){
 		lastInsn = PREV_INSN(lastInsn);
@@ -74,7 +86,15 @@ rtx_insn* UpdatePoint::lastRealINSN(basic_block bb){
 	return lastInsn;
 }
 
+/**
+ * Function that returns the last INSN of the basic block
+ * after which instructions can be inserted without separating
+ * the final jump from the compare feeding it
+ */
 rtx_insn* UpdatePoint::lastRealSafeINSN(basic_block bb){
+	if(BlockSummary::isBuilt()){
+		return BlockSummary::lastSafe(bb);
+	}
 	rtx_insn* lastInsn = lastRealINSN(bb);
 	if(InstrType::isReturn(lastInsn)){
 		lastInsn = PREV_INSN(lastInsn);
@@ -82,6 +102,10 @@ rtx_insn* UpdatePoint::lastRealSafeINSN(basic_block bb){
 	else if(JUMP_P(lastInsn) && !InstrType::isCondJump(lastInsn)){
 			lastInsn = PREV_INSN(lastInsn);
 		}
+	else if (InstrType::isCBZ(lastInsn)){
+			// A CBZ or CBNZ that was not split does not depend on a compare
+			lastInsn = PREV_INSN(lastInsn);
+		}
 	else if (JUMP_P(lastInsn) && InstrType::isCondJump(lastInsn)){
 			do{
 				lastInsn = PREV_INSN(lastInsn);
@@ -10,6 +10,10 @@
 #include "CFEDcreator.h"
 #include "ArmISA_Functions.h"
 #include "Printer.h"
+#include "DumpWriter.h"
+#include "PhaseTimer.h"
+#include "FunctionRNG.h"
+#include "PlanCache.h"
 
 
 /**
@@ -21,7 +25,7 @@ const struct pass_data CFED_PLUGIN_pass_data =
 		.type = RTL_PASS,
 		.name = "myPlugin",
 		.optinfo_flags = OPTGROUP_NONE,
-		.tv_id = TV_TREE_CLEANUP_CFG,
+		.tv_id = TV_PLUGIN_RUN,
 		.properties_required = 0,//(PROP_rtl | PROP_cfglayout),
 		.properties_provided = 0,
 		.properties_destroyed = 0,
@@ -42,6 +46,18 @@ CFED_PLUGIN::CFED_PLUGIN(gcc::context *ctxt, struct plugin_argument *arguments,
 {
 		argc = argcounter;			// nr. of arguments
 		args = arguments;			// array containing arrguments (key,value)
+
+		const char* dumpLevel = findOptionalArgumentValue("dumpLevel", "rtl");
+		if(!Printer::setDumpLevel(dumpLevel)){
+			printf("\x1b[91mUnknown dumpLevel \x1b[91;1m'%s'\x1b[91m, using rtl\x1b[0m\n", dumpLevel);
+		}
+
+		const char* seed = findOptionalArgumentValue("seed", "0");
+		if(!FunctionRNG::setSeed(seed)){
+			printf("\x1b[91mInvalid seed \x1b[91;1m'%s'\x1b[91m, using 0\x1b[0m\n", seed);
+		}
+
+		PlanCache::setDirectory(findOptionalArgumentValue("planCache", ""));
 }
 
 /**
@@ -79,25 +95,43 @@ unsigned int CFED_PLUGIN::execute(function *fun)
 	strcpy(dirName, "GCC_Plugin_Output/");
 	strcat(dirName, funName);
 
-	printf("\x1b[92m GCC Plugin executing for function \x1b[92;1m %s \x1b[0m\n",funName);
-
-	// 3)Create the needed directories
-	mkdir("GCC_Plugin_Output", 0766);
-	int status = mkdir(dirName, 0766);
-	if (status == -1){
-		int counter = rand() % 1000;
-		char renameName[512];
-		strcpy(renameName,dirName);
-		strcat(renameName, (to_string(counter)).c_str());
-		rename(dirName, renameName);
-		mkdir(dirName, 0766);
-		counter++;
+	DumpLevel dumpLevel = Printer::getDumpLevel();
+	if(Printer::isVerbose()){
+		printf("\x1b[92m GCC Plugin executing for function \x1b[92;1m %s \x1b[0m\n",funName);
+	}
+
+	// 3)Create the needed directories, also without dumps for the trap-site map (Traps.txt)
+	bool trapMap = !strcmp(findOptionalArgumentValue("detection", "branch"), "trap");
+	if(dumpLevel != DUMP_NONE || trapMap){
+		mkdir("GCC_Plugin_Output", 0766);
+		int status = mkdir(dirName, 0766);
+		if (status == -1){
+			// The queued dumps of the previous function with this name must land before the rename
+			DumpWriter::finish();
+			int counter = rand() % 1000;
+			char renameName[512];
+			strcpy(renameName,dirName);
+			strcat(renameName, (to_string(counter)).c_str());
+			rename(dirName, renameName);
+			mkdir(dirName, 0766);
+			counter++;
+		}
 	}
 
 	// 4) Print out the desired info
-	Printer::printRTL((char *)"RTL.txt");			// Print the RTL statements to file
-	Printer::printEdges((char *)"Edges.txt");		// Print the CFE in edge form
-	Printer::printAnalysis((char *)"Analysis.txt");	// Print the analyses for all basic blocks
+	{
+		PhaseTimer timer("CFED dumps");
+		if(dumpLevel == DUMP_RTL){
+			Printer::printRTL((char *)"RTL.txt");			// Print the RTL statements to file
+		}
+		if(dumpLevel == DUMP_EDGES || dumpLevel == DUMP_RTL || dumpLevel == DUMP_DELTA){
+			Printer::printEdges((char *)"Edges.txt");		// Print the CFE in edge form
+		}
+		if(dumpLevel != DUMP_NONE){
+			Printer::printAnalysis((char *)"Analysis.txt");	// Print the analyses for all basic blocks
+		}
+	}
+	int firstNewUID = get_max_uid();
 
 	// 5) Implement the technique
 	try{
@@ -112,9 +146,19 @@ unsigned int CFED_PLUGIN::execute(function *fun)
 			throw "Wrong technique type provided!\n";
 		}
 
-		Printer::printRTL((char*)"RTL_Protected.txt");
+		{
+			PhaseTimer timer("CFED dumps");
+			if(dumpLevel == DUMP_RTL){
+				Printer::printRTL((char*)"RTL_Protected.txt");
+			}
+			else if(dumpLevel == DUMP_DELTA){
+				Printer::printDelta((char*)"RTL_Inserted.txt", firstNewUID);
+			}
+		}
 
-		printf("\x1b[92m--------------------- Plugin fully ran -----------------------\n\x1b[0m");
+		if(Printer::isVerbose()){
+			printf("\x1b[92m--------------------- Plugin fully ran -----------------------\n\x1b[0m");
+		}
 		return 0;
 	}
 	catch (const char* e){
@@ -144,6 +188,22 @@ const char* CFED_PLUGIN::findArgumentValue(const char* key){
 	throw (const char*) msg;
 }
 
+/**
+ * Generic function to get the value out of the
+ * argv array, matching the given key, for arguments that may be omitted
+ * @param Key The key of the argument to get the value for
+ * @param defaultValue The value to return if the argument is not provided
+ * @return Value The const char* representation of the value
+ */
+const char* CFED_PLUGIN::findOptionalArgumentValue(const char* key, const char* defaultValue){
+	for (int i=0; i< argc; i++){
+		if(!strcmp(args[i].key, key)){
+			return args[i].value;
+		}
+	}
+	return defaultValue;
+}
+
 /**
  * Function that analyses all arguments and searches if the
  * current function was given as argument. Only then the pass
@@ -156,8 +216,10 @@ bool CFED_PLUGIN::isAllowedToRun(const char* funName){
 	try{
 		const char* f = findArgumentValue("function");
 		if(lookup_attribute("noProtection", DECL_ATTRIBUTES(current_function_decl))){
-			printf("\x1b[32m GCC Plugin not executing for function %s \x1b[0m\n",funName);
-			printf("\t\x1b[96mFunction specified as not needing protection\x1b[0m\n");
+			if(Printer::isVerbose()){
+				printf("\x1b[32m GCC Plugin not executing for function %s \x1b[0m\n",funName);
+				printf("\t\x1b[96mFunction specified as not needing protection\x1b[0m\n");
+			}
 			return false;
 		}
 		else if( (!strcmp(f, funName)) || (strlen(f) == 0 ) ){
@@ -176,9 +238,69 @@ bool CFED_PLUGIN::isAllowedToRun(const char* funName){
 void CFED_PLUGIN::implementDetectionTechnique(bool intraBlockDet){
 	try{
 		const char* technique = findArgumentValue("techniqueSpecific");
-		unsigned int selectiveLevel = atoi(findArgumentValue("selectiveLevel"));
-		CFEDcreator* cfedCreator = new CFEDcreator();
-		cfedCreator->implementTechnique(technique, intraBlockDet, selectiveLevel);
+		CFEDoptions options;
+		options.intraBlockDet = intraBlockDet;
+		options.selectiveLevel = atoi(findArgumentValue("selectiveLevel"));
+		options.profileThreshold = findOptionalArgumentValue("profileThreshold", "p90");
+		options.loopCheckInterval = atoi(findOptionalArgumentValue("loopCheckInterval", "1"));
+		options.autoCoverage = atoi(findOptionalArgumentValue("autoCoverage", "0"));
+		options.autoLatency = atoi(findOptionalArgumentValue("autoLatency", "0"));
+		options.autoSizeBudget = atoi(findOptionalArgumentValue("autoSizeBudget", "0"));
+		options.peephole = atoi(findOptionalArgumentValue("peephole", "1")) != 0;
+		const char* sigAssignment = findOptionalArgumentValue("sigAssignment", "random");
+		if(!strcmp(sigAssignment, "optimized")){
+			options.optimizeSignatures = true;
+		}
+		else if(!strcmp(sigAssignment, "random")){
+			options.optimizeSignatures = false;
+		}
+		else{
+			throw "Wrong sigAssignment provided. Values are random or optimized";
+		}
+		const char* regAllocation = findOptionalArgumentValue("regAllocation", "fixed");
+		if(!strcmp(regAllocation, "free")){
+			options.freeRegisters = true;
+		}
+		else if(!strcmp(regAllocation, "fixed")){
+			options.freeRegisters = false;
+		}
+		else{
+			throw "Wrong regAllocation provided. Values are fixed or free";
+		}
+		options.reschedule = atoi(findOptionalArgumentValue("reschedule", "0")) != 0;
+		const char* encoding = findOptionalArgumentValue("encoding", "wide");
+		if(!strcmp(encoding, "compact")){
+			options.compactEncoding = true;
+		}
+		else if(!strcmp(encoding, "wide")){
+			options.compactEncoding = false;
+		}
+		else{
+			throw "Wrong encoding provided. Values are wide or compact";
+		}
+		options.registers = findOptionalArgumentValue("registers", NULL);
+		const char* detection = findOptionalArgumentValue("detection", "branch");
+		if(!strcmp(detection, "trap")){
+			options.trapDetection = true;
+		}
+		else if(!strcmp(detection, "branch")){
+			options.trapDetection = false;
+		}
+		else{
+			throw "Wrong detection provided. Values are branch or trap";
+		}
+		const char* errorStubs = findOptionalArgumentValue("errorStubs", "end");
+		if(!strcmp(errorStubs, "near")){
+			options.nearErrorStubs = true;
+		}
+		else if(!strcmp(errorStubs, "end")){
+			options.nearErrorStubs = false;
+		}
+		else{
+			throw "Wrong errorStubs provided. Values are end or near";
+		}
+		CFEDcreator cfedCreator;
+		cfedCreator.implementTechnique(technique, options);
 	} catch (const char* e){
 		printf("\x1b[91mCFE Detection Technique was not implemented:\x1b[0m\n\t%s\n", e);
 	}
@@ -32,6 +32,7 @@ class CFED_PLUGIN : public rtl_opt_pass{
 
 	private:
 		const char* findArgumentValue(const char* key);
+		const char* findOptionalArgumentValue(const char* key, const char* defaultValue);
 
 		bool isAllowedToRun(const char* funName);
 
@@ -21,6 +21,8 @@
 #include <stdio.h>
 
 #include "CFED_Plugin.h"
+#include "DumpWriter.h"
+#include "CFEDcreator.h"
 
 
 // Mandatory variable, indicates that a GPL compatible license is applied to this GCC plugin.
@@ -49,6 +51,13 @@ static void register_attributes(void *event_data, void *data){
 }
 
 
+// Write out the remaining dump files and free the technique before the compiler exits
+static void finish_plugin(void *event_data, void *data){
+	DumpWriter::finish();
+	CFEDcreator::release();
+}
+
+
 // Start point of the plugin
 int plugin_init(struct plugin_name_args *info, struct plugin_gcc_version *ver){
 	if(strncmp(ver->basever,myPlugin_ver.basever, strlen("7.3"))){
@@ -63,6 +72,7 @@ int plugin_init(struct plugin_name_args *info, struct plugin_gcc_version *ver){
 
 	register_callback("myPlugin", PLUGIN_PASS_MANAGER_SETUP, NULL, &pass);
 	register_callback("myPlugin", PLUGIN_ATTRIBUTES, register_attributes, NULL);
+	register_callback("myPlugin", PLUGIN_FINISH, finish_plugin, NULL);
 
 	return 0;
 }
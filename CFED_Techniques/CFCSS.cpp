@@ -8,36 +8,80 @@
 #include <basic-block.h>
 #include <rtl.h>
 
+#include <algorithm>
+
 #include "CFCSS.h"
+#include "PlanCache.h"
 #include "AsmGen.h"
 #include "UpdatePoint.h"
 #include "InstrType.h"
+#include "PhaseTimer.h"
+#include "Printer.h"
 
 /**
  * Constructor, initializes necessary variables
  */
 CFCSS::CFCSS(ARM_ISA* isa, unsigned int nrOfRegsToUse)
 	:GeneralCFED(isa, nrOfRegsToUse){
-	diffSigs.reserve(n_basic_blocks_for_fn(cfun)-2);
+}
+
+/**
+ * Function to reset the per-function variables
+ */
+void CFCSS::initVariables(){
+	diffSigs.assign(n_basic_blocks_for_fn(cfun)-2, 0);
 	createPaths();
+	assignSignatureGroups();
+}
+
+/**
+ * Function to tell the largest number of basic blocks CFCSS can protect:
+ * each signature group is represented by one bit of the 32-bit signature
+ */
+unsigned int CFCSS::maxNrOfBB(){
+	return 32;
 }
 
 /**
  * Function to calculate / assign the
- * 	- compile-time signatures for each basic block
+ * 	- compile-time signatures for each basic block, one per signature group
  * 	- differential signature for each basic block
  */
 void CFCSS::calcVariables(){
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) - 2;
-		signatures[idBB] = 1 << idBB;
+		signatures[idBB] = 1 << groupOf[idBB];
 	}
 	FOR_EACH_BB_FN(bb, cfun){
 		calcDiffSigs(bb);
 	}
 }
 
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void CFCSS::savePlan(vector<int>& plan){
+	PlanCache::appendValues(plan, this->diffSigs);
+	plan.push_back(paths.size());
+	for(unsigned int i = 0; i < paths.size(); i++){
+		plan.push_back(paths[i].upD);
+	}
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void CFCSS::loadPlan(vector<int>& plan, unsigned int& pos){
+	PlanCache::readValues(plan, pos, this->diffSigs);
+	if(PlanCache::readValue(plan, pos) != paths.size()){
+		throw "Plan cache entry does not match the paths of CFCSS";
+	}
+	for(unsigned int i = 0; i < paths.size(); i++){
+		paths[i].upD = PlanCache::readValue(plan, pos);
+	}
+}
+
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  */
@@ -50,14 +94,13 @@ void CFCSS::insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx
  * at the beginning of each basic block
  * Inserts:
  * 	EOR r11, #<differentialSignature>
- * 	EOR r11, r10 (if necessary)
+ * 	EOR r11, r10 (if the basic block uses the run-time adjusting signature)
  * 	CMP r11, #<compileTimeSignature>
  * 	BNE .codelabel
  */
 void CFCSS::insertBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore){
-	unsigned int inEdges = countIncomingEdges(bb);
 	rtx_insn* prev = AsmGen::emitEorRegInt(regsToUse[0], diffSigs[idBB], attachBefore, bb, false);
-	if(inEdges > 1){
+	if(needsD[idBB]){
 		prev = insertEOR(prev, bb);
 	}
 	prev = AsmGen::emitCmpRegInt(regsToUse[0], signatures[idBB], prev, bb, true);
@@ -77,10 +120,10 @@ void CFCSS::insertMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel,
  * at the end of each basic block
  * Inserts
  * 	MOV r10, #<number> -> updates r10 to the correct value depending on the situation
+ * Nothing is inserted if no successor uses the run-time adjusting signature
  */
 void CFCSS::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
-	if (!InstrType::isExitBlock(bb)){
-		vector<CFCSSpath>::const_iterator it;
+	if (!InstrType::isExitBlock(bb) && needsDUpdate(idBB)){
 		rtx_insn* lastInsn = UpdatePoint::lastRealINSN(bb);
 		if(InstrType::isCondJump(lastInsn)){
 			rtx_code trueCode = InstrType::getCondCode(lastInsn);
@@ -88,12 +131,12 @@ void CFCSS::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 			unsigned int trueUpD = 0;
 			unsigned int falseUpD = 0;
 			// Find correct UpD values
-			for(it = paths.begin(); it != paths.end(); it++){
-				if((*it).startBBId == idBB && (*it).endBBId != (idBB+1)){
-					trueUpD = (*it).upD;
+			for(unsigned int i = pathOffsets[idBB]; i < pathOffsets[idBB+1]; i++){
+				if(paths[i].endBBId != (idBB+1)){
+					trueUpD = paths[i].upD;
 				}
-				else if((*it).startBBId == idBB){
-					falseUpD = (*it).upD;
+				else{
+					falseUpD = paths[i].upD;
 				}
 			}
 			if (trueUpD == falseUpD){
@@ -105,29 +148,98 @@ void CFCSS::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 				AsmGen::emitCondMovRegInt(falseCode, regsToUse[1], falseUpD, trueRtx, bb, true);
 			}
 		}
+		else if(InstrType::isTableJump(lastInsn)){
+			// r10 gets the value of the first successor using it, the others get a trampoline
+			this->tableUpD = 0;
+			for(unsigned int i = pathOffsets[idBB+1]; i-- > pathOffsets[idBB]; ){
+				if((paths[i].endBBId < needsD.size()) && needsD[paths[i].endBBId]){
+					this->tableUpD = paths[i].upD;
+				}
+			}
+			AsmGen::emitMovRegInt(regsToUse[1], tableUpD, lastInsn, bb, false);
+			insertTableTrampolines(idBB, bb);
+		}
 		else{
 			unsigned int UpD = 0;
-			for(it = paths.begin(); it != paths.end(); it++){
-				if((*it).startBBId == idBB){
-					UpD = (*it).upD;
-				}
+			if(pathOffsets[idBB] != pathOffsets[idBB+1]){
+				UpD = paths[pathOffsets[idBB+1]-1].upD;
 			}
 			AsmGen::emitMovRegInt(regsToUse[1], UpD, lastInsn, bb, false);
 		}
 	}
 }
 
+/**
+ * Function to insert the update of r10 in the trampoline towards a successor of a table jump
+ * Emits
+ * 	MOV r10, #<number> -> only if the successor uses the run-time adjusting signature
+ * 	                      and needs another value than the one set before the table jump
+ */
+void CFCSS::insertTableAdjust(unsigned int idBB, unsigned int idSuccs){
+	CFCSSpath* path = findPath(idBB, idSuccs);
+	if((path != NULL) && needsD[idSuccs] && (path->upD != tableUpD)){
+		AsmGen::emitMovRegInt(regsToUse[1], path->upD, 0x00, 0x00, true);
+	}
+}
+
+/**
+ * CFCSS only updates r10 conditionally (MOV<cond>) when both successors
+ * need a different D value. A path only needs a non-zero D value when it
+ * enters a basic block using the run-time adjusting signature from another
+ * signature group than the one its differential signature is based on.
+ */
+bool CFCSS::needsCondUpdate(unsigned int idBB, basic_block bb){
+	if(bb->succs->length() != 2){
+		return false;
+	}
+	int dRef[2] = {-1, -1};
+	unsigned int i = 0;
+	edge e;
+	edge_iterator ei;
+	FOR_EACH_EDGE(e, ei, bb->succs){
+		basic_block dest = e->dest;
+		if((dest->index > 2) && needsD[dest->index - 2]){
+			unsigned int refGroup = groupOf[referencePredId(dest)];
+			if(refGroup != groupOf[idBB]){
+				dRef[i] = refGroup;
+			}
+		}
+		i++;
+	}
+	return (dRef[0] != dRef[1]);
+}
+
+/**
+ * CFCSS handles table jumps: the successors that need another value
+ * of r10 than the one set before the jump get a trampoline
+ */
+bool CFCSS::supportsTableJumps(){
+	return true;
+}
+
 /**
  * Function to insert the necessary setup code at the beginning of the first basic block
  * Inserts
  * 	MOV r11, #0
  * 	MOV r10, #0
+ * Also reports the number of merge blocks that use the run-time adjusting signature
  */
 void CFCSS::insertSetup(){
 	basic_block bb = BASIC_BLOCK_FOR_FN(cfun, 2);
 	rtx_insn* prev = UpdatePoint::firstRealINSN(bb);
 	prev = AsmGen::emitMovRegInt(regsToUse[0], 0, prev, bb, false);
 	AsmGen::emitMovRegInt(regsToUse[1], 0, prev, bb, true);
+
+	if(!AsmGen::isDryRun()){
+		unsigned int withD = 0;
+		for(unsigned int idBB = 1; idBB < needsD.size(); idBB++){
+			withD += needsD[idBB];
+		}
+		PhaseTimer::count(STAT_MERGE_BLOCKS_WITH_D, withD);
+		if(Printer::isVerbose()){
+			printf("\t\x1b[96mCFCSS: %u of %u merge blocks need the run-time adjusting signature\x1b[0m\n", withD, this->nrOfMergeBlocks);
+		}
+	}
 }
 
 /**
@@ -136,9 +248,8 @@ void CFCSS::insertSetup(){
  */
 void CFCSS::insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore){
 	//throw "Selective implementation for CFCSS not officially supported and therefore not implemented!";
-	unsigned int inEdges = countIncomingEdges(bb);
 	rtx_insn* prev = AsmGen::emitEorRegInt(regsToUse[0], diffSigs[idBB], attachBefore, bb, false);
-	if(inEdges > 1){
+	if(needsD[idBB]){
 		prev = insertEOR(prev, bb);
 	}
 	if(InstrType::isExitBlock(bb)){
@@ -147,6 +258,15 @@ void CFCSS::insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabe
 	}
 }
 
+/**
+ * Function to insert only the verification of the signature register,
+ * after the update at the beginning of a loop latch
+ */
+rtx_insn* CFCSS::insertLoopCheck(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter){
+	rtx_insn* prev = AsmGen::emitCmpRegInt(regsToUse[0], signatures[idBB], attachAfter, bb, true);
+	return AsmGen::emitBne(codeLabel, prev, bb, true);
+}
+
 /**
  * Function to insert the necessary selective form of the inter-block
  * CFE detection instructions in the middle of the basic block
@@ -165,6 +285,125 @@ void CFCSS::insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel)
 	insertEnd(idBB, bb, codeLabel);
 }
 
+/**
+ * Function to divide the basic blocks into signature groups, all blocks of a
+ * group get the same signature. Without optimized signatures each basic block
+ * is a group of its own.
+ * With optimized signatures (sigAssignment=optimized), the predecessors of a merge
+ * block are joined into one group, so they all have the same XOR-distance to the
+ * merge block and it needs no run-time adjusting signature D (no EOR r11, r10).
+ * The merge blocks are handled most frequent first. Two groups are only joined if
+ * no edge connects them, so a basic block never shares the signature of a
+ * neighbouring basic block. A merge block whose predecessors cannot all be joined
+ * keeps using D.
+ * Only depends on the CFG, so it is computed before the CBZ instructions are split.
+ */
+void CFCSS::assignSignatureGroups(){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	vector<unsigned int> parent(nrOfBB);
+	for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+		parent[idBB] = idBB;
+	}
+
+	// Find the merge blocks, the first basic block always keeps its D
+	vector<pair<gcov_type, unsigned int> > mergeBlocks;
+	this->needsD.assign(nrOfBB, false);
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		unsigned int idBB = (bb->index) - 2;
+		if(countIncomingEdges(bb) > 1){
+			this->needsD[idBB] = true;
+			if(idBB != 0){
+				mergeBlocks.push_back(make_pair(blockWeight(bb), idBB));
+			}
+		}
+	}
+	this->nrOfMergeBlocks = mergeBlocks.size();
+
+	if(this->optimizeSignatures){
+		// Groups connected by an edge can not be joined
+		vector<vector<bool> > connected(nrOfBB, vector<bool>(nrOfBB, false));
+		for(unsigned int i = 0; i < paths.size(); i++){
+			if((paths[i].endBBId < nrOfBB) && (paths[i].startBBId != paths[i].endBBId)){
+				connected[paths[i].startBBId][paths[i].endBBId] = true;
+				connected[paths[i].endBBId][paths[i].startBBId] = true;
+			}
+		}
+
+		stable_sort(mergeBlocks.begin(), mergeBlocks.end(),
+				[](const pair<gcov_type, unsigned int>& first, const pair<gcov_type, unsigned int>& second){ return first.first > second.first; });
+		vector<unsigned int> roots;
+		for(unsigned int m = 0; m < mergeBlocks.size(); m++){
+			bb = BASIC_BLOCK_FOR_FN(cfun, mergeBlocks[m].second + 2);
+			roots.clear();
+			edge e;
+			edge_iterator ei;
+			FOR_EACH_EDGE(e, ei, bb->preds){
+				unsigned int root = findGroup(parent, (e->src)->index - 2);
+				if(find(roots.begin(), roots.end(), root) == roots.end()){
+					roots.push_back(root);
+				}
+			}
+			bool joinable = true;
+			for(unsigned int i = 0; (i < roots.size()) && joinable; i++){
+				for(unsigned int j = i+1; (j < roots.size()) && joinable; j++){
+					joinable = !connected[roots[i]][roots[j]];
+				}
+			}
+			if(!joinable){
+				continue;
+			}
+			for(unsigned int i = 1; i < roots.size(); i++){
+				parent[roots[i]] = roots[0];
+				for(unsigned int k = 0; k < nrOfBB; k++){
+					if(connected[roots[i]][k]){
+						connected[roots[0]][k] = true;
+						connected[k][roots[0]] = true;
+					}
+				}
+			}
+			this->needsD[mergeBlocks[m].second] = false;
+		}
+	}
+
+	// Number the groups in order of their first basic block
+	this->groupOf.assign(nrOfBB, 0);
+	vector<int> groupIndex(nrOfBB, -1);
+	unsigned int nrOfGroups = 0;
+	for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+		unsigned int root = findGroup(parent, idBB);
+		if(groupIndex[root] == -1){
+			groupIndex[root] = nrOfGroups++;
+		}
+		this->groupOf[idBB] = groupIndex[root];
+	}
+}
+
+/**
+ * Function to find the representative basic block of the signature group
+ * of the basic block, compressing the path to it
+ */
+unsigned int CFCSS::findGroup(vector<unsigned int>& parent, unsigned int idBB){
+	while(parent[idBB] != idBB){
+		parent[idBB] = parent[parent[idBB]];
+		idBB = parent[idBB];
+	}
+	return idBB;
+}
+
+/**
+ * Function to determine whether r10 must be updated at the end of the basic block:
+ * only if one of its successors uses the run-time adjusting signature
+ */
+bool CFCSS::needsDUpdate(unsigned int idBB){
+	for(unsigned int i = pathOffsets[idBB]; i < pathOffsets[idBB+1]; i++){
+		if((paths[i].endBBId < needsD.size()) && needsD[paths[i].endBBId]){
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * Function to calculate the differential signature of the basic block
  */
@@ -182,8 +421,9 @@ void CFCSS::calcDiffSigs(basic_block bb){
 			predIds.push_back(predId);
 		}
 		// check for circular loopback to block
+		unsigned int refId = referencePredId(bb);
 		for (int i = 1; i < predIds.size(); i ++){
-			if(predIds[i] == idBB){
+			if(predIds[i] == refId){
 				unsigned int temp = predIds[i];
 				predIds[i] = predIds[0];
 				predIds[0] = temp;
@@ -194,12 +434,9 @@ void CFCSS::calcDiffSigs(basic_block bb){
 		if (predIds.size() > 1){
 			for( int x = 1; x < predIds.size(); x++){
 				unsigned int idPred = predIds[x];
-				vector<CFCSSpath>::iterator it;
-				for(it = paths.begin(); it != paths.end(); it++){
-					if((*it).startBBId == idPred && (*it).endBBId == idBB){
-						unsigned int upD = signatures[idPred] ^ signatures[predIds[0]];
-						(*it).upD = upD;
-					}
+				CFCSSpath* path = findPath(idPred, idBB);
+				if(path != NULL){
+					path->upD = signatures[idPred] ^ signatures[predIds[0]];
 				}
 			}
 		}
@@ -209,6 +446,24 @@ void CFCSS::calcDiffSigs(basic_block bb){
 	}
 }
 
+/**
+ * Function to determine the predecessor the differential signature
+ * of the basic block is based on: the basic block itself in case of
+ * a circular loopback, otherwise its first predecessor
+ */
+unsigned int CFCSS::referencePredId(basic_block bb){
+	unsigned int idBB = bb->index - 2;
+	unsigned int refId = (bb->preds->length() != 0) ? EDGE_PRED(bb, 0)->src->index - 2 : idBB;
+	edge e;
+	edge_iterator ei;
+	FOR_EACH_EDGE(e, ei, bb->preds){
+		if((e->src)->index - 2 == idBB){
+			refId = idBB;
+		}
+	}
+	return refId;
+}
+
 /**
  * Function to calculate the number of incoming edges
  * of the basic block
@@ -231,27 +486,58 @@ rtx_insn* CFCSS::insertEOR(rtx_insn* previous, basic_block bb){
 	rtx regD = gen_rtx_REG(SImode, regsToUse[1]);
 	rtx xorRtx = gen_rtx_XOR(SImode, regSig, regD);
 	rtx set = gen_movsi(regSig, xorRtx);
-	return emit_insn_after_noloc(set, previous, bb);
+	return AsmGen::emitInsn(set, previous, bb, true);
 }
 
 /**
- * Creates a vector containing all different paths in the CFG
+ * Creates the edge table containing all different paths in the CFG
  * A path contains a start basic block and an end basic block.
  * Necessary to calculate the correct differential signatures and to update
  * r10 at the end of each basic block
+ *
+ * The table is stored in compressed sparse row form: the paths are grouped
+ * per start basic block, and the paths starting in basic block idBB are
+ * paths[pathOffsets[idBB]] up to (not including) paths[pathOffsets[idBB+1]].
  */
 void CFCSS::createPaths(){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
 	basic_block bb;
+	// Count the outgoing edges of each basic block
+	pathOffsets.assign(nrOfBB+1, 0);
+	FOR_EACH_BB_FN(bb, cfun){
+		unsigned int idBB = (bb->index) - 2;
+		pathOffsets[idBB+1] = bb->succs->length();
+	}
+	for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+		pathOffsets[idBB+1] += pathOffsets[idBB];
+	}
+	// Fill in the paths, keeping the CFG order of the outgoing edges
+	paths.resize(pathOffsets[nrOfBB]);
+	vector<unsigned int> fill(pathOffsets.begin(), pathOffsets.end()-1);
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) - 2;
 		edge e;
 		edge_iterator ei;
 		FOR_EACH_EDGE(e, ei, bb->succs){
 			unsigned int idSuccs = (e->dest)->index -2;
-			CFCSSpath path;
+			CFCSSpath& path = paths[fill[idBB]++];
 			path.startBBId = idBB;
 			path.endBBId = idSuccs;
-			paths.push_back(path);
+			path.upD = 0;
+		}
+	}
+}
+
+/**
+ * Function to find the path from the start basic block to the end basic block
+ * Only scans the outgoing paths of the start basic block
+ * Returns NULL if no such path exists
+ */
+CFCSSpath* CFCSS::findPath(unsigned int startBBId, unsigned int endBBId){
+	for(unsigned int i = pathOffsets[startBBId]; i < pathOffsets[startBBId+1]; i++){
+		if(paths[i].endBBId == endBBId){
+			return &paths[i];
 		}
 	}
+	return NULL;
 }
@@ -28,7 +28,11 @@ class CFCSS : public GeneralCFED{
 		~CFCSS(){}
 
 	private:
+		void initVariables();
+		unsigned int maxNrOfBB();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -36,19 +40,35 @@ class CFCSS : public GeneralCFED{
 		void insertMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
 		void insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 		void insertSetup();
+		bool supportsTableJumps();
+
+		bool needsCondUpdate(unsigned int idBB, basic_block bb);
 
 		// Selective methods
 		void insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore);
 		void insertSelMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
 		void insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
+		rtx_insn* insertLoopCheck(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
+		void insertTableAdjust(unsigned int idBB, unsigned int idSuccs);
+
+		void assignSignatureGroups();
+		unsigned int findGroup(vector<unsigned int>& parent, unsigned int idBB);
+		bool needsDUpdate(unsigned int idBB);
 		void calcDiffSigs(basic_block bb);
 		unsigned int countIncomingEdges(basic_block bb);
+		unsigned int referencePredId(basic_block bb);
 		rtx_insn* insertEOR(rtx_insn* previous, basic_block bb);
 		void createPaths();
+		CFCSSpath* findPath(unsigned int startBBId, unsigned int endBBId);
 
 		vector<unsigned int> diffSigs;
-		vector<CFCSSpath> paths;
+		vector<unsigned int> groupOf;			// Index of the signature group per basic block
+		vector<bool> needsD;					// Per basic block: whether the run-time adjusting signature is used
+		unsigned int nrOfMergeBlocks;
+		unsigned int tableUpD;					// Value of r10 at the current table jump
+		vector<CFCSSpath> paths;				// Grouped per start basic block
+		vector<unsigned int> pathOffsets;		// Start index in paths per basic block, nrOfBB+1 entries
 };
 
 #endif /* CFED_TECHNIQUES_CFCSS_H_ */
@@ -24,6 +24,13 @@
 #include "YACCA_Fast.h"
 #include "RSCFC.h"
 #include "SIED.h"
+#include "PlanCache.h"
+#include "Printer.h"
+
+ARM_ISA* CFEDcreator::isa = NULL;
+map<string, GeneralCFED*> CFEDcreator::techniques;
+// The techniques considered by techniqueSpecific=auto, in order of preference for equal costs
+const char* CFEDcreator::autoCandidates[] = {"RACFED", "SEDSR", "SCFC", "CFCSS", "ECCA", "YACCA", "YACCA_Fast", "RSCFC", "SIED", NULL};
 
 /**
  * Function to implement the selected CFE detection technique.
@@ -31,9 +38,47 @@
  * 	2) creates the selected CFE detection technique
  * 	3) calls the implementTechnique of the created CFE detection technique
  * 		to effectively implement the technique.
+ * Steps 1 and 2 are only done once per translation unit and technique,
+ * the plugin arguments are the same for all functions.
+ * With technique 'auto', the technique is first selected for the current function.
  */
-void CFEDcreator::implementTechnique(const char *technique, bool intraBlockDet, unsigned int selectiveLevel){
+void CFEDcreator::implementTechnique(const char *technique, CFEDoptions& options){
 	// 1) Create object for the ISA
+	if(isa == NULL){
+		isa = createISA();
+	}
+	isa->setRegisters(options.registers, options.compactEncoding);
+
+	// 2) Create object for the CFE detection technique
+	if(!strcmp(technique, "auto")){
+		technique = selectTechnique(options);
+	}
+	GeneralCFED* genCFED = getTechnique(technique, options.intraBlockDet);
+
+	// 3) Implement the selected technique
+	PlanCache::setTechnique(technique, options);
+	genCFED->implementTechnique(options);
+}
+
+/**
+ * Function to delete the ISA and technique objects,
+ * called when the compilation of the translation unit is finished
+ */
+void CFEDcreator::release(){
+	for(map<string, GeneralCFED*>::iterator it = techniques.begin(); it != techniques.end(); ++it){
+		delete it->second;
+	}
+	techniques.clear();
+	delete isa;
+	isa = NULL;
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Function to create the object for the ISA of the current CPU
+ */
+ARM_ISA* CFEDcreator::createISA(){
 	ARM_ISA* isa;
 	switch(ARM_ISA::getISAtarget(arm_cpu_option)){
 		case ARMv6M:
@@ -49,8 +94,68 @@ void CFEDcreator::implementTechnique(const char *technique, bool intraBlockDet,
 			throw "Not supported target and therefore unknown ISA!\n";
 			break;
 	}
+	return isa;
+}
 
-	// 2) Create object for the CFE detection technique
+/**
+ * Function to return the object for the provided CFE detection technique,
+ * which is created the first time it is needed
+ */
+GeneralCFED* CFEDcreator::getTechnique(const char* technique, bool intraBlockDet){
+	map<string, GeneralCFED*>::iterator it = techniques.find(technique);
+	if(it != techniques.end()){
+		return it->second;
+	}
+	GeneralCFED* genCFED = createTechnique(technique, intraBlockDet);
+	techniques[technique] = genCFED;
+	return genCFED;
+}
+
+/**
+ * Function to select the technique for the current function (techniqueSpecific=auto).
+ * Estimates the cost of every candidate with a dry run and selects the one with
+ * the lowest number of executed inserted instructions (then the lowest code size)
+ * that meets the coverage, latency and code size constraints.
+ */
+const char* CFEDcreator::selectTechnique(CFEDoptions& options){
+	const char* selected = NULL;
+	CFEDcost selectedCost;
+	for(unsigned int i = 0; autoCandidates[i] != NULL; i++){
+		GeneralCFED* candidate = getTechnique(autoCandidates[i], options.intraBlockDet);
+		PlanCache::setTechnique(autoCandidates[i], options);
+		CFEDcost cost;
+		if(!candidate->estimateCost(options, cost)){
+			continue;
+		}
+		if(cost.coverage < options.autoCoverage){
+			continue;
+		}
+		if((options.autoLatency != 0) && (cost.latency > options.autoLatency)){
+			continue;
+		}
+		if((options.autoSizeBudget != 0) && ((unsigned long long) cost.insertedInsns * 100 > (unsigned long long) options.autoSizeBudget * cost.origInsns)){
+			continue;
+		}
+		if((selected == NULL) || (cost.executedInsns < selectedCost.executedInsns) ||
+				((cost.executedInsns == selectedCost.executedInsns) && (cost.insertedInsns < selectedCost.insertedInsns))){
+			selected = autoCandidates[i];
+			selectedCost = cost;
+		}
+	}
+	if(selected == NULL){
+		throw "No technique meets the constraints of techniqueSpecific=auto (autoCoverage, autoLatency, autoSizeBudget)";
+	}
+	if(Printer::isVerbose()){
+		printf("\t\x1b[96mauto: %s selected, %.1f inserted instructions executed per call, %u inserted, latency %u, coverage %u%%\x1b[0m\n",
+				selected, selectedCost.executedInsns, selectedCost.insertedInsns, selectedCost.latency, selectedCost.coverage);
+	}
+	return selected;
+}
+
+/**
+ * Function to create the object for the selected CFE detection technique
+ */
+GeneralCFED* CFEDcreator::createTechnique(const char* technique, bool intraBlockDet){
 	GeneralCFED* genCFED;
 	if(!strcmp(technique, "RACFED")){
 		genCFED = new RACFED(isa, 1);
@@ -82,7 +187,5 @@ void CFEDcreator::implementTechnique(const char *technique, bool intraBlockDet,
 	else{
 		throw "Unknown technique supplied to implement!\n";
 	}
-
-	// 3) Implement the selected technique
-	genCFED->implementTechnique(intraBlockDet, selectiveLevel);
+	return genCFED;
 }
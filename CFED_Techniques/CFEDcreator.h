@@ -7,11 +7,16 @@
 /**
  * Header file for the CFEDcreator class.
  *
- * Has only one method 'implementTechnique' which
+ * Has the method 'implementTechnique' which
  * 	1) determines the ISA of the current CPU
  * 	2) creates the selected CFE detection technique
  * 	3) calls the implementTechnique of the created CFE detection technique
  * 		to effectively implement the technique.
+ * The ISA and technique objects are created once per translation unit
+ * and reused for every function, 'release' deletes them.
+ *
+ * With technique 'auto', the cost of every technique is estimated per function
+ * and the cheapest one that meets the constraints is implemented.
  */
 
 #ifndef CFED_TECHNIQUES_CFEDCREATOR_H_
@@ -21,10 +26,32 @@
 #include <basic-block.h>
 #include <rtl.h>
 
+#include "GeneralCFED.h"
+#include "ArmISA_Functions.h"
+#include "structsHolder.h"
+
+#include <map>
+#include <string>
+
+using namespace std;
+
 class CFEDcreator{
 	public:
 		// Function to create the correct technique and implement it
-		void implementTechnique(const char* technique, bool intraBlockDet, unsigned int selectiveLevel);
+		void implementTechnique(const char* technique, CFEDoptions& options);
+
+		// Function to delete the ISA and technique objects
+		static void release();
+
+	private:
+		static ARM_ISA* isa;
+		static map<string, GeneralCFED*> techniques;
+		static const char* autoCandidates[];
+
+		static ARM_ISA* createISA();
+		static GeneralCFED* getTechnique(const char* technique, bool intraBlockDet);
+		static GeneralCFED* createTechnique(const char* technique, bool intraBlockDet);
+		static const char* selectTechnique(CFEDoptions& options);
 };
 
 
@@ -9,6 +9,7 @@
 #include <rtl.h>
 
 #include "ECCA.h"
+#include "PlanCache.h"
 #include "primeNumbers.h"
 #include "AsmGen.h"
 #include "UpdatePoint.h"
@@ -21,6 +22,21 @@ ECCA::ECCA(ARM_ISA* isa, unsigned int nrOfRegsToUse)
 	:GeneralCFED(isa, nrOfRegsToUse){
 }
 
+/**
+ * Function to reset the per-function variables
+ */
+void ECCA::initVariables(){
+	nextValues.clear();
+}
+
+/**
+ * Function to tell the largest number of basic blocks ECCA can protect:
+ * each basic block needs its own prime number as signature
+ */
+unsigned int ECCA::maxNrOfBB(){
+	return primeNumber.size();
+}
+
 /**
  * Function to calculate / assign the
  * 	- compile-time signature for each basic block
@@ -38,6 +54,28 @@ void ECCA::calcVariables(){
 	}
 }
 
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void ECCA::savePlan(vector<int>& plan){
+	plan.push_back(nextValues.size());
+	for(unsigned int i = 0; i < nextValues.size(); i++){
+		plan.push_back(nextValues[i].Next1);
+		plan.push_back(nextValues[i].Next2);
+	}
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void ECCA::loadPlan(vector<int>& plan, unsigned int& pos){
+	nextValues.resize(PlanCache::readValue(plan, pos));
+	for(unsigned int i = 0; i < nextValues.size(); i++){
+		nextValues[i].Next1 = PlanCache::readValue(plan, pos);
+		nextValues[i].Next2 = PlanCache::readValue(plan, pos);
+	}
+}
+
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  */
@@ -60,21 +98,33 @@ void ECCA::insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_
  * 	UDIV r11, r11, r10
  * 	MOV r10, #( <compileTimeSignature> + 1 )
  * 	UDIV r11, r10, r11
+ * ARMv6-M has no divider, so the division-free form is inserted there instead,
+ * see insertZeroTest
  */
 void ECCA::insertBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore){
-	rtx_insn* prev = AsmGen::emitSubRegInt(regsToUse[0], signatures[idBB], attachBefore, bb, false);
-	prev = AsmGen::emitSubRegInt(regsToUse[1], signatures[idBB], prev, bb, true);
-	prev = insertMUL(idBB, prev, bb);
-	prev = AsmGen::emitCmpRegInt(regsToUse[0], 0, prev, bb, true);
-	prev = AsmGen::emitBne(codeLabel, prev, bb, true);
+	AsmGen::startSequence();
+	AsmGen::emitSubRegInt(regsToUse[0], signatures[idBB], NULL, bb, true);
+	AsmGen::emitSubRegInt(regsToUse[1], signatures[idBB], NULL, bb, true);
+	insertMUL(idBB, NULL, bb);
+	AsmGen::emitCmpRegInt(regsToUse[0], 0, NULL, bb, true);
+	AsmGen::emitBne(codeLabel, NULL, bb, true);
 	if(!InstrType::isExitBlock(bb)){
-		prev = insertLSL(idBB, prev, bb);
-		prev = AsmGen::emitAddRegInt(regsToUse[0], 1, prev, bb, true);
-		prev = AsmGen::emitAddRegInt(regsToUse[1], 1, prev, bb, true);
-		prev = AsmGen::emitUdivRegRegReg(regsToUse[0], regsToUse[0], regsToUse[1], prev, bb, true);
-		prev = AsmGen::emitMovRegInt(regsToUse[1], signatures[idBB]+1, prev, bb, true);
-		prev = AsmGen::emitUdivRegRegReg(regsToUse[0], regsToUse[1], regsToUse[0],prev, bb, true);
+		switch(ARM_ISA::getISAtarget(arm_cpu_option)){
+			case ARMv7M:
+				insertLSL(idBB, NULL, bb);
+				AsmGen::emitAddRegInt(regsToUse[0], 1, NULL, bb, true);
+				AsmGen::emitAddRegInt(regsToUse[1], 1, NULL, bb, true);
+				AsmGen::emitUdivRegRegReg(regsToUse[0], regsToUse[0], regsToUse[1], NULL, bb, true);
+				AsmGen::emitMovRegInt(regsToUse[1], signatures[idBB]+1, NULL, bb, true);
+				AsmGen::emitUdivRegRegReg(regsToUse[0], regsToUse[1], regsToUse[0], NULL, bb, true);
+				break;
+			case ARMv6M:
+			default:
+				insertZeroTest(idBB, bb);
+				break;
+		}
 	}
+	AsmGen::endSequence(attachBefore, bb, false);
 }
 
 /**
@@ -95,10 +145,12 @@ void ECCA::insertMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel,
  */
 void ECCA::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 	if(!InstrType::isExitBlock(bb)){
-		rtx_insn* prev = UpdatePoint::lastRealINSN(bb);
-		prev = AsmGen::emitSubRegInt(regsToUse[0], signatures[idBB]+1, prev, bb, !JUMP_P(prev));
-		prev = insertADD(idBB, prev, bb);
-		prev = AsmGen::emitAddRegInt(regsToUse[0], nextValues[idBB].Next1, prev, bb, true);
+		rtx_insn* last = UpdatePoint::lastRealINSN(bb);
+		AsmGen::startSequence();
+		AsmGen::emitSubRegInt(regsToUse[0], signatures[idBB]+1, NULL, bb, true);
+		insertADD(idBB, NULL, bb);
+		AsmGen::emitAddRegInt(regsToUse[0], nextValues[idBB].Next1, NULL, bb, true);
+		AsmGen::endSequence(last, bb, !JUMP_P(last));
 	}
 }
 
@@ -171,7 +223,7 @@ rtx_insn* ECCA::insertMUL(unsigned int idBB, rtx_insn* previous, basic_block bb)
 	rtx operand = gen_rtx_REG(SImode, regsToUse[1]);
 	rtx mult = gen_rtx_MULT(SImode, destReg,operand);
 	rtx set = gen_movsi(destReg, mult);
-	return emit_insn_after_noloc(set, previous, bb);
+	return AsmGen::emitInsn(set, previous, bb, true);
 }
 
 /**
@@ -183,7 +235,31 @@ rtx_insn* ECCA::insertLSL(unsigned int idBB, rtx_insn* previous, basic_block bb)
 	rtx constInt= gen_rtx_CONST_INT(VOIDmode, 1);
 	rtx lsl = gen_rtx_ROTATE(SImode, srcReg, constInt);
 	rtx set = gen_movsi(destReg, lsl);
-	return emit_insn_after_noloc(set, previous, bb);
+	return AsmGen::emitInsn(set, previous, bb, true);
+}
+
+/**
+ * Emits the division-free form of the ECCA test for ARMv6-M:
+ * 	RSB r10, r11, #0
+ * 	ORR r10, r11
+ * 	LSR r10, #31
+ * 	SUB r10, #1
+ * 	MOV r11, #( <compileTimeSignature> + 1 )
+ * 	AND r11, r10
+ * Like the UDIV form, r11 becomes <compileTimeSignature> + 1 if the product of
+ * the test is 0 and 0 otherwise, so a skipped BNE still leaves a wrong signature.
+ * (r11 | -r11) has its sign bit set for every non-zero r11, which gives the mask
+ * without dividing.
+ */
+void ECCA::insertZeroTest(unsigned int idBB, basic_block bb){
+	rtx regSig = gen_rtx_REG(SImode, regsToUse[0]);
+	rtx regTemp = gen_rtx_REG(SImode, regsToUse[1]);
+	AsmGen::emitInsn(gen_movsi(regTemp, gen_rtx_NEG(SImode, regSig)), NULL, bb, true);
+	AsmGen::emitInsn(gen_movsi(regTemp, gen_rtx_IOR(SImode, regTemp, regSig)), NULL, bb, true);
+	AsmGen::emitInsn(gen_movsi(regTemp, gen_rtx_LSHIFTRT(SImode, regTemp, GEN_INT(31))), NULL, bb, true);
+	AsmGen::emitSubRegInt(regsToUse[1], 1, NULL, bb, true);
+	AsmGen::emitMovRegInt(regsToUse[0], signatures[idBB]+1, NULL, bb, true);
+	AsmGen::emitInsn(gen_movsi(regSig, gen_rtx_AND(SImode, regSig, regTemp)), NULL, bb, true);
 }
 
 /**
@@ -195,5 +271,5 @@ rtx_insn* ECCA::insertADD(unsigned int idBB, rtx_insn* previous, basic_block bb)
 	rtx constInt = gen_rtx_CONST_INT(SImode, nextValues[idBB].Next2);
 	rtx add = gen_rtx_PLUS(SImode, srcReg, constInt);
 	rtx set = gen_movsi(destReg, add);
-	return emit_insn_after_noloc(set, previous, bb);
+	return AsmGen::emitInsn(set, previous, bb, true);
 }
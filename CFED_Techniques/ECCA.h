@@ -28,7 +28,11 @@ class ECCA : public GeneralCFED{
 		~ECCA(){}
 
 	private:
+		void initVariables();
+		unsigned int maxNrOfBB();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -46,6 +50,7 @@ class ECCA : public GeneralCFED{
 		rtx_insn* insertMUL(unsigned int idBB, rtx_insn* previous, basic_block bb);
 		rtx_insn* insertLSL(unsigned int idBB, rtx_insn* previous, basic_block bb);
 		rtx_insn* insertADD(unsigned int idBB, rtx_insn* previous, basic_block bb);
+		void insertZeroTest(unsigned int idBB, basic_block bb);
 
 		vector<ECCAnext> nextValues;
 };
@@ -0,0 +1,127 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+#include <tree.h>
+
+#include <stdlib.h>
+
+#include "FunctionRNG.h"
+
+uint64_t FunctionRNG::seed = 0;
+uint64_t FunctionRNG::functionKey = 0;
+uint64_t FunctionRNG::key = 0;
+uint64_t FunctionRNG::counter = 0;
+
+/**
+ * Function to set the seed shared by all functions of the translation unit
+ * @param value The decimal or hexadecimal representation of the seed
+ * @return bool False if the value is not a valid number, the seed is then left unchanged
+ */
+bool FunctionRNG::setSeed(const char* value){
+	char* end;
+	unsigned long long parsed = strtoull(value, &end, 0);
+	if((*value == '\0') || (*end != '\0')){
+		return false;
+	}
+	seed = parsed;
+	return true;
+}
+
+/**
+ * Returns the seed shared by all functions of the translation unit
+ */
+uint64_t FunctionRNG::getSeed(){
+	return seed;
+}
+
+/**
+ * Function to start the stream of the current function.
+ * Must be called before the CFG of the function is changed.
+ */
+void FunctionRNG::startFunction(){
+	const char* asmName = IDENTIFIER_POINTER(DECL_ASSEMBLER_NAME(current_function_decl));
+	functionKey = mix(seed ^ mix(hashString(asmName) ^ mix(hashCFG())));
+	key = functionKey;
+	counter = 0;
+}
+
+/**
+ * Function to start the stream used to compute the plan of the current function
+ * @param shapeHash The hash of the shape the plan is computed for
+ */
+void FunctionRNG::startPlan(uint64_t shapeHash){
+	key = mix(seed ^ mix(shapeHash));
+	counter = 0;
+}
+
+/**
+ * Function to start the stream used while inserting the instructions,
+ * independent of whether the plan was computed or taken from the cache
+ */
+void FunctionRNG::startInsertion(){
+	key = mix(functionKey + 1);
+	counter = 0;
+}
+
+/**
+ * Function to get the next value of the stream of the current function
+ * Drop-in replacement for rand(): returns a value in [0, 2^31[
+ */
+int FunctionRNG::next(){
+	counter++;
+	return (int)(mix(key + counter * 0x9E3779B97F4A7C15ULL) >> 33);
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Finalizer of SplitMix64, spreads every input bit over the whole output
+ */
+uint64_t FunctionRNG::mix(uint64_t value){
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+/**
+ * FNV-1a hash of the provided string
+ */
+uint64_t FunctionRNG::hashString(const char* str){
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	while(*str != '\0'){
+		hash = (hash ^ (unsigned char)*str) * 0x100000001B3ULL;
+		str++;
+	}
+	return hash;
+}
+
+/**
+ * Function to hash the CFG of the current function.
+ * Uses the basic block indices, their successors and the codes of their
+ * real instructions. UIDs are not used, they change with -g.
+ */
+uint64_t FunctionRNG::hashCFG(){
+	uint64_t hash = mix(n_basic_blocks_for_fn(cfun));
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		hash = mix(hash ^ bb->index);
+		edge e;
+		edge_iterator ei;
+		FOR_EACH_EDGE(e, ei, bb->succs){
+			hash = mix(hash ^ ((uint64_t)e->dest->index << 32));
+		}
+		rtx_insn* insn;
+		FOR_BB_INSNS(bb, insn){
+			if(NONDEBUG_INSN_P(insn)){
+				hash = mix(hash ^ GET_CODE(PATTERN(insn)));
+			}
+		}
+	}
+	return hash;
+}
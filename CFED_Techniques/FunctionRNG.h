@@ -0,0 +1,54 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * Header file for the FunctionRNG class.
+ *
+ * Contains the prototypes of the methods used to generate the
+ * random values of the techniques (signatures, intra-block values, ...).
+ *
+ * Each function gets its own counter-based stream, keyed by the
+ * seed plugin argument, the assembler name of the function and a hash
+ * of its CFG. The output therefore only depends on the function itself
+ * and not on the time or the order in which functions are compiled.
+ *
+ * The values used to compute the plan of a function come from a separate
+ * stream, keyed by the seed and the shape of the plan only. Functions with
+ * the same shape get the same plan, whether it is computed or taken from
+ * the PlanCache.
+ */
+
+#ifndef CFED_TECHNIQUES_FUNCTIONRNG_H_
+#define CFED_TECHNIQUES_FUNCTIONRNG_H_
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include <stdint.h>
+
+class FunctionRNG{
+	public:
+		static bool setSeed(const char* value);
+		static uint64_t getSeed();
+		static void startFunction();
+		static void startPlan(uint64_t shapeHash);
+		static void startInsertion();
+		static int next();
+
+	private:
+		static uint64_t seed;
+		static uint64_t functionKey;
+		static uint64_t key;
+		static uint64_t counter;
+
+		static uint64_t mix(uint64_t value);
+		static uint64_t hashString(const char* str);
+		static uint64_t hashCFG();
+};
+
+
+#endif /* CFED_TECHNIQUES_FUNCTIONRNG_H_ */
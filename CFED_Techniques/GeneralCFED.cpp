@@ -8,62 +8,263 @@
 #include <basic-block.h>
 #include <rtl.h>
 #include <emit-rtl.h>
+#include <cfgloop.h>
 
 #include <stdlib.h>
+#include <limits.h>
+#include <stdio.h>
+
+#include <algorithm>
 
 #include "GeneralCFED.h"
 #include "ArmISA_Functions.h"
 #include "UpdatePoint.h"
 #include "AsmGen.h"
 #include "InstrType.h"
+#include "BlockSummary.h"
+#include "FunctionRNG.h"
+#include "PlanCache.h"
+#include "Peephole.h"
+#include "Scheduler.h"
+#include "EncodingSize.h"
+#include "ErrorStubs.h"
+#include "PhaseTimer.h"
+#include "Printer.h"
 
 /**
- * Constructor, initializes the necessary variables.
+ * Constructor, initializes the variables that are the same for all functions.
+ * The object is created once per translation unit.
  */
 GeneralCFED::GeneralCFED(ARM_ISA* isa, unsigned int nrOfRegsToUse){
 	this->isa = isa;
+	// The registers argument can provide too few, selectRegisters refuses these per function
+	vector<unsigned int> regs = this->isa->getNecessaryRegisters();
 	for(int i = 0; i < nrOfRegsToUse; i++){
-		this->regsToUse.push_back(this->isa->getNecessaryRegisters()[i]);
+		this->regsToUse.push_back((i < regs.size()) ? regs[i] : 0);
 	}
-	this->signatures.reserve(n_basic_blocks_for_fn(cfun)-2);
-	this->nrOfOrigInstr.reserve(n_basic_blocks_for_fn(cfun)-2);
-	this->insnID = get_max_uid();
-	srand(time(NULL));
+	this->insnID = 0;
+	this->loopCounterReg = 0;
+	this->optimizeSignatures = false;
+	this->compactEncoding = false;
 }
 
 /**
  * Function which implements the selected CFE detection technique.
  * Determines in which order the pure virtual functions are executed.
  */
-void GeneralCFED::implementTechnique(bool intraBlockDet, unsigned int selectiveLevel){
-	// 1) Change the CBZ instructions
-	isa->changeCBZ(); // Was after insterError();
+void GeneralCFED::implementTechnique(CFEDoptions& options){
+	// 0) Drop the state of the previous function
+	this->optimizeSignatures = options.optimizeSignatures;
+	this->compactEncoding = options.compactEncoding;
+	AsmGen::setTrapDetection(options.trapDetection);
+	startFunction();
+	checkTableJumps();
+	selectRegisters(options.freeRegisters);
+	unsigned int literalsAvoided = AsmGen::nrOfLiteralsAvoided();
+	if(options.freeRegisters && Printer::isVerbose()){
+		printf("\t\x1b[96mRegisters:");
+		for(unsigned int i = 0; i < this->regsToUse.size(); i++){
+			printf(" r%u", this->regsToUse[i]);
+		}
+		printf("\x1b[0m\n");
+	}
+
+	// 1) Change the CBZ instructions that need conditional updates
+	{
+		PhaseTimer timer("CFED CBZ splitting");
+		vector<bool> condUpdateBlocks(n_basic_blocks_for_fn(cfun)-2, false);
+		basic_block bb;
+		FOR_EACH_BB_FN(bb, cfun){
+			unsigned int idBB = (bb->index) - 2;
+			condUpdateBlocks[idBB] = needsCondUpdate(idBB, bb);
+		}
+		isa->changeCBZ(condUpdateBlocks); // Was after insterError();
+	}
 
-	// 2) Count the number of original instructions -> needed by some techniques
-    countNrOfOrigInstr();
+	// 2) Summarize the basic blocks and count the number of original instructions -> needed by some techniques
+	{
+		PhaseTimer timer("CFED counting");
+		countNrOfOrigInstr();
+	}
 
-    // 3) Calculate the necessary variables, such as signatures, etc.
-	calcVariables();
+    // 3) Calculate the necessary variables, such as signatures, etc. or reuse the plan of an identical function
+	{
+		PhaseTimer timer("CFED calcVariables");
+		planVariables();
+	}
 
 	// 4) Insert the jump the CFED_Detected
 	rtx_insn* codeLabel = insertError();
 
 	// 5) Implement the technique, based on which selective level is provided
-	if(selectiveLevel == 0){
-		fullyImplementInAllBB(intraBlockDet, codeLabel);
+	{
+		PhaseTimer timer("CFED block insertion");
+		implementInAllBB(options, codeLabel);
+	}
+
+	// 6) Insert the setup code for the technique
+	{
+		PhaseTimer timer("CFED setup");
+		insertSetup();
+	}
+
+	// 7) Insert the necessary Push and Pop of the signature register (and loop counter)
+	vector<unsigned int> regsToSave(this->regsToUse);
+	if(this->loopCounterReg != 0){
+		regsToSave.push_back(this->loopCounterReg);
 	}
-	else if(selectiveLevel == 1){
-		selectiveImplementInAllBB(intraBlockDet, codeLabel);
+	{
+		PhaseTimer timer("CFED push/pop");
+		isa->insertPushPop(regsToSave);
+	}
+
+	// 8) Fold the inserted instructions, once the blocks are no longer changed
+	if(options.peephole){
+		PhaseTimer timer("CFED peephole");
+		unsigned int removed = Peephole::optimize(this->firstInsnUID, regsToSave);
+		PhaseTimer::count(STAT_PEEPHOLE_REMOVED, removed);
+		if(Printer::isVerbose()){
+			printf("\t\x1b[96mPeephole: %u inserted instructions removed\x1b[0m\n", removed);
+		}
+	}
+
+	// 9) Interleave the inserted instructions with the independent original ones
+	if(options.reschedule && (ARM_ISA::getISAtarget(arm_cpu_option) != ARMv6M)){
+		PhaseTimer timer("CFED scheduling");
+		unsigned int cyclesSaved = 0;
+		unsigned int moved = Scheduler::schedule(this->firstInsnUID, cyclesSaved);
+		PhaseTimer::count(STAT_SCHEDULER_MOVED, moved);
+		PhaseTimer::count(STAT_SCHEDULER_CYCLES_SAVED, cyclesSaved);
+		if(Printer::isVerbose()){
+			printf("\t\x1b[96mScheduler: %u instructions moved, %u cycles saved (estimated)\x1b[0m\n", moved, cyclesSaved);
+		}
+	}
+
+	// 10) Place error stubs near the checks that cannot reach the one at the end with a 16-bit branch
+	if(options.nearErrorStubs && !options.trapDetection){
+		PhaseTimer timer("CFED error stubs");
+		unsigned int farBefore, farAfter;
+		bool endUsed = true;
+		unsigned int placed = ErrorStubs::place(codeLabel, farBefore, farAfter, endUsed);
+		PhaseTimer::count(STAT_ERROR_STUBS, placed);
+		PhaseTimer::count(STAT_FAR_CHECKS, farAfter);
+		if(Printer::isVerbose()){
+			int saved = 2*((int) farBefore - (int) farAfter) - 4*(int) placed + (endUsed ? 0 : 4);
+			printf("\t\x1b[96mError stubs: %u placed, far checks %u -> %u (about %d bytes saved)\x1b[0m\n", placed, farBefore, farAfter, saved);
+		}
+	}
+
+	// 11) Report the encoding size of the inserted instructions
+	{
+		unsigned int narrow, wide;
+		EncodingSize::count(this->firstInsnUID, narrow, wide);
+		PhaseTimer::count(STAT_INSERTED_16BIT, narrow);
+		PhaseTimer::count(STAT_INSERTED_32BIT, wide);
+		if(Printer::isVerbose()){
+			printf("\t\x1b[96mEncoding: %u 16-bit and %u 32-bit inserted instructions (%u bytes)\x1b[0m\n", narrow, wide, 2*narrow + 4*wide);
+			literalsAvoided = AsmGen::nrOfLiteralsAvoided() - literalsAvoided;
+			if(literalsAvoided != 0){
+				printf("\t\x1b[96mEncoding: %u literal loads avoided\x1b[0m\n", literalsAvoided);
+			}
+		}
+	}
+
+	// 12) Write down which basic block each trap belongs to, whatever the dump level:
+	// without it the sites decoded by the fault handler cannot be interpreted
+	if(options.trapDetection){
+		if(Printer::isVerbose()){
+			printf("\t\x1b[96mTraps: %u check sites\x1b[0m\n", (unsigned int) AsmGen::getTrapSites().size());
+		}
+		Printer::printTrapSites((char*)"Traps.txt", AsmGen::getTrapSites());
+	}
+
+	// 13) The block summary is only valid for the current function
+	BlockSummary::clear();
+}
+
+/**
+ * Implements the technique in all basic blocks, based on which selective level is provided
+ */
+void GeneralCFED::implementInAllBB(CFEDoptions& options, rtx_insn* codeLabel){
+	if(options.selectiveLevel == 0){
+		fullyImplementInAllBB(options.intraBlockDet, codeLabel);
+	}
+	else if(options.selectiveLevel == 1){
+		selectiveImplementInAllBB(options.intraBlockDet, codeLabel);
+	}
+	else if(options.selectiveLevel == 2){
+		profileImplementInAllBB(options.intraBlockDet, options.profileThreshold, codeLabel);
+	}
+	else if(options.selectiveLevel == 3){
+		loopImplementInAllBB(options.intraBlockDet, options.loopCheckInterval, codeLabel);
 	}
 	else{
-		throw "Wrong selectiveLevel provided. Values are 0 or 1";
+		throw "Wrong selectiveLevel provided. Values are 0, 1, 2 or 3";
 	}
+}
 
-	// 6) Insert the setup code for the technique
-	insertSetup();
+/**
+ * Function to estimate the cost of the technique for the current function, without changing its RTL.
+ * Runs the technique as a dry run, in which the inserted instructions are only counted,
+ * and fills in:
+ * 	- the number of inserted instructions and the number of original instructions
+ * 	- the estimated number of inserted instructions executed per call of the function
+ * 	- the worst-case detection latency in instructions: the largest checked basic block
+ * 	  plus all basic blocks without a check, through which a CFE can pass undetected
+ * 	- the percentage of basic blocks that contain a check
+ * Returns false if the technique cannot protect the function with the provided options.
+ */
+bool GeneralCFED::estimateCost(CFEDoptions& options, CFEDcost& cost){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	if(nrOfBB > maxNrOfBB()){
+		return false;
+	}
+	try{
+		this->optimizeSignatures = options.optimizeSignatures;
+		this->compactEncoding = options.compactEncoding;
+		AsmGen::setTrapDetection(options.trapDetection);
+		startFunction();
+		checkTableJumps();
+		selectRegisters(options.freeRegisters);
+		countNrOfOrigInstr();
+		planVariables();
+		this->dryRunInsns.assign(nrOfBB, 0);
+		this->dryRunChecked.assign(nrOfBB, false);
+		AsmGen::startDryRun();
+		implementInAllBB(options, gen_label_rtx());
+		insertSetup();
+		cost.insertedInsns = AsmGen::endDryRun();
+	}
+	catch(const char* e){
+		AsmGen::endDryRun();
+		BlockSummary::clear();
+		return false;
+	}
 
-	// 7) Insert the necessary Push and Pop of the signature register
-	isa->insertPushPop(this->regsToUse);
+	gcov_type entryWeight = max(blockWeight(ENTRY_BLOCK_PTR_FOR_FN(cfun)), (gcov_type) 1);
+	unsigned int nrOfChecked = 0;
+	unsigned int largestChecked = 0;
+	unsigned int unchecked = 0;
+	cost.origInsns = 0;
+	cost.executedInsns = 0;
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		unsigned int idBB = (bb->index) - 2;
+		unsigned int size = BlockSummary::nrOfRealInstr(bb) + this->dryRunInsns[idBB];
+		cost.origInsns += this->nrOfOrigInstr[idBB];
+		cost.executedInsns += (double) this->dryRunInsns[idBB] * blockWeight(bb) / entryWeight;
+		if(this->dryRunChecked[idBB]){
+			nrOfChecked++;
+			largestChecked = max(largestChecked, size);
+		}
+		else{
+			unchecked += size;
+		}
+	}
+	cost.latency = largestChecked + unchecked;
+	cost.coverage = (nrOfBB == 0) ? 100 : (nrOfChecked * 100) / nrOfBB;
+	BlockSummary::clear();
+	return true;
 }
 
 /**
@@ -80,14 +281,7 @@ void GeneralCFED::fullyImplementInAllBB(bool intraBlockDet, rtx_insn* codeLabel)
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) - 2;
-		if(intraBlockDet){
-			insertIntraBlockJumpDetection(idBB, bb, codeLabel);
-		}
-		rtx_insn* middleInsn = UpdatePoint::middleRealINSN(bb);
-		insertMiddle(idBB, bb, codeLabel, middleInsn);
-		rtx_insn* firstInsn = UpdatePoint::firstRealINSN(bb);
-		insertBegin(idBB, bb, codeLabel, firstInsn);
-		insertEnd(idBB, bb, codeLabel);
+		implementInBB(idBB, bb, intraBlockDet, false, codeLabel);
 	}
 }
 
@@ -106,46 +300,518 @@ void GeneralCFED::selectiveImplementInAllBB(bool intraBlockDet, rtx_insn* codeLa
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) - 2;
-		if(intraBlockDet){
-			insertIntraBlockJumpDetection(idBB, bb, codeLabel);
+		implementInBB(idBB, bb, intraBlockDet, true, codeLabel);
+	}
+}
+
+/**
+ * Implements the profile-guided form of the selected CFE detection technique.
+ * Hot basic blocks (execution count above the threshold) get the selective form,
+ * so they keep the signature updates but lose their verification instructions.
+ * All other basic blocks get the full form.
+ * Reports the estimated number of executed checks that is saved.
+ */
+void GeneralCFED::profileImplementInAllBB(bool intraBlockDet, const char* profileThreshold, rtx_insn* codeLabel){
+	vector<bool> hotBlocks = findHotBlocks(profileThreshold);
+	unsigned int nrOfHotBlocks = 0;
+	gcov_type checksSaved = 0;
+	gcov_type checksFull = 0;
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		unsigned int idBB = (bb->index) - 2;
+		bool isHot = hotBlocks[idBB] && !InstrType::isExitBlock(bb);
+		implementInBB(idBB, bb, intraBlockDet, isHot, codeLabel);
+		checksFull += blockWeight(bb);
+		if(isHot){
+			nrOfHotBlocks++;
+			checksSaved += blockWeight(bb);
+		}
+	}
+	if(AsmGen::isDryRun()){
+		return;
+	}
+	PhaseTimer::count(STAT_DYNAMIC_CHECKS_SAVED, (checksSaved > INT_MAX) ? INT_MAX : (int) checksSaved);
+	if(Printer::isVerbose()){
+		if(profile_status_for_fn(cfun) != PROFILE_READ){
+			printf("\t\x1b[96mNo profile feedback, using estimated block frequencies\x1b[0m\n");
+		}
+		printf("\t\x1b[96mProfile: %u of %u basic blocks hot, estimated executed checks saved: %lld of %lld\x1b[0m\n",
+				nrOfHotBlocks, (unsigned int) hotBlocks.size(), (long long) checksSaved, (long long) checksFull);
+	}
+}
+
+/**
+ * Implements the loop-aware form of the selected CFE detection technique.
+ * Basic blocks inside a natural loop get the selective form, so they keep
+ * the signature updates and any illegal edge still corrupts the signature.
+ * The comparison is moved to:
+ * 	- the loop latches, every loopCheckInterval iterations (counted in a spare register)
+ * 	- the loop exits, as the basic blocks outside the loop keep the full form
+ * A loopCheckInterval of 1 checks the latches every iteration, 0 only checks at the exits.
+ * Exit basic blocks inside a loop always keep the full form.
+ */
+void GeneralCFED::loopImplementInAllBB(bool intraBlockDet, unsigned int loopCheckInterval, rtx_insn* codeLabel){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	vector<bool> latchBlocks(nrOfBB, false);
+
+	// The iterations are counted in the first register the technique does not use,
+	// checked before the loop structures are attached to the function
+	if(loopCheckInterval > 1){
+		if(this->spareRegs.empty()){
+			throw "A loopCheckInterval above 1 needs a register that is not used by the technique";
+		}
+		this->loopCounterReg = this->spareRegs[0];
+	}
+
+	loop_optimizer_init(AVOID_CFG_MODIFICATIONS);
+	struct loop* loop;
+	FOR_EACH_LOOP(loop, 0){
+		vec<edge> latchEdges = get_loop_latch_edges(loop);
+		for(unsigned int i = 0; i < latchEdges.length(); i++){
+			if(latchEdges[i]->src->index >= 2){
+				latchBlocks[(latchEdges[i]->src->index) - 2] = true;
+			}
 		}
-		rtx_insn* middleInsn = UpdatePoint::middleRealINSN(bb);
+		latchEdges.release();
+	}
+
+
+	double cyclesSaved = 0;
+	unsigned int nrOfHoisted = 0;
+	basic_block bb;
+	try{
+		FOR_EACH_BB_FN(bb, cfun){
+			unsigned int idBB = (bb->index) - 2;
+			bool inLoop = (loop_depth(bb->loop_father) > 0) && !InstrType::isExitBlock(bb);
+			bool latchCheck = latchBlocks[idBB] && (loopCheckInterval > 0);
+			if(!inLoop || (latchCheck && loopCheckInterval == 1)){
+				implementInBB(idBB, bb, intraBlockDet, false, codeLabel);
+				continue;
+			}
+			rtx_insn* firstInsn = UpdatePoint::firstRealINSN(bb);
+			implementInBB(idBB, bb, intraBlockDet, true, codeLabel);
+			// The condition flags of a block starting with a conditional jump cannot be changed
+			if(latchCheck && !InstrType::isCondJump(firstInsn)){
+				insertLoopCounterCheck(idBB, bb, loopCheckInterval, codeLabel, firstInsn);
+				cyclesSaved += (double) blockWeight(bb) * (loopCheckCycles * (loopCheckInterval-1) / loopCheckInterval - loopCounterCycles);
+			}
+			else{
+				nrOfHoisted++;
+				cyclesSaved += (double) blockWeight(bb) * loopCheckCycles;
+			}
+		}
+	}
+	catch(const char* e){
+		// Do not leave the loop structures attached for the later passes
+		loop_optimizer_finalize();
+		throw;
+	}
+
+	// Start counting at the beginning of the function
+	if(this->loopCounterReg != 0){
+		basic_block firstBB = BASIC_BLOCK_FOR_FN(cfun, 2);
+		AsmGen::emitMovRegInt(this->loopCounterReg, loopCheckInterval, UpdatePoint::firstRealINSN(firstBB), firstBB, false);
+	}
+
+	if(!AsmGen::isDryRun()){
+		PhaseTimer::count(STAT_LOOP_CHECKS_HOISTED, nrOfHoisted);
+		if(Printer::isVerbose()){
+			reportLoopLatency(loopCheckInterval, cyclesSaved);
+		}
+	}
+	loop_optimizer_finalize();
+}
+
+/**
+ * Function to insert the check of a loop latch that is only executed every loopCheckInterval iterations:
+ * 	SUB counter,#1
+ * 	CMP counter,#0
+ * 	BNE .skip
+ * 	MOV counter,#loopCheckInterval
+ * 	<check of the technique>
+ * 	.skip:
+ */
+void GeneralCFED::insertLoopCounterCheck(unsigned int idBB, basic_block bb, unsigned int loopCheckInterval, rtx_insn* codeLabel, rtx_insn* attachBefore){
+	rtx_insn* skipLabel = AsmGen::emitCodeLabel(insnID++, attachBefore, bb, false);
+	rtx_insn* prev = AsmGen::emitSubRegInt(this->loopCounterReg, 1, skipLabel, bb, false);
+	prev = AsmGen::emitCmpRegInt(this->loopCounterReg, 0, prev, bb, true);
+	prev = AsmGen::emitCondJump(NE, skipLabel, prev, bb, true);
+	prev = AsmGen::emitMovRegInt(this->loopCounterReg, loopCheckInterval, prev, bb, true);
+	insertLoopCheck(idBB, bb, codeLabel, prev);
+}
+
+/**
+ * Function to print the worst-case CFE detection latency of the loops,
+ * in instructions, and the estimated number of cycles saved per call of the function.
+ * An illegal edge inside a loop is detected at the latest after loopCheckInterval
+ * iterations of the loop body, or at the loop exit if the latches are not checked.
+ */
+void GeneralCFED::reportLoopLatency(unsigned int loopCheckInterval, double cyclesSaved){
+	unsigned int nrOfLoops = 0;
+	unsigned int largestBody = 0;
+	struct loop* loop;
+	FOR_EACH_LOOP(loop, 0){
+		basic_block* body = get_loop_body(loop);
+		unsigned int bodySize = 0;
+		for(unsigned int i = 0; i < loop->num_nodes; i++){
+			if(body[i]->index >= 2){
+				bodySize += BlockSummary::nrOfRealInstr(body[i]);
+			}
+		}
+		free(body);
+		nrOfLoops++;
+		largestBody = max(largestBody, bodySize);
+	}
+	gcov_type entryWeight = blockWeight(ENTRY_BLOCK_PTR_FOR_FN(cfun));
+	if(entryWeight > 0){
+		cyclesSaved /= entryWeight;
+	}
+	if(loopCheckInterval == 0){
+		printf("\t\x1b[96mLoops: %u, worst-case detection latency: until the loop exit (%u instructions per iteration), estimated cycles saved per call: %.1f\x1b[0m\n",
+				nrOfLoops, largestBody, cyclesSaved);
+	}
+	else{
+		printf("\t\x1b[96mLoops: %u, worst-case detection latency: %u instructions, estimated cycles saved per call: %.1f\x1b[0m\n",
+				nrOfLoops, loopCheckInterval * largestBody, cyclesSaved);
+	}
+}
+
+/**
+ * Implements the selected CFE detection technique in a single basic block:
+ * 	1) Insert the intra-block CFE detection instructions if necessary
+ * 	2) Determine the middle rtx_insn and insert the CFE detection
+ * 		instructions in the middle of the basic block
+ *	3) Determine the first rtx_insn and insert the CFE detection
+ *		instructions at the beginning of the basic block
+ *	4) Insert the CFE detection instructions at the end of the basic block
+ *	Uses the selective forms of these instructions if selective is set.
+ *	During a dry run, the number of instructions and whether a check is inserted are recorded.
+ */
+void GeneralCFED::implementInBB(unsigned int idBB, basic_block bb, bool intraBlockDet, bool selective, rtx_insn* codeLabel){
+	unsigned int nrOfInstr = BlockSummary::nrOfRealInstr(bb);
+	unsigned int dryRunInsnsBefore = AsmGen::nrOfDryRunInsns();
+	unsigned int dryRunChecksBefore = AsmGen::nrOfDryRunChecks();
+	if(intraBlockDet){
+		insertIntraBlockJumpDetection(idBB, bb, codeLabel);
+	}
+	rtx_insn* middleInsn = UpdatePoint::middleRealINSN(bb);
+	rtx_insn* firstInsn;
+	if(selective){
 		insertSelMiddle(idBB, bb, codeLabel, middleInsn);
-		rtx_insn* firstInsn = UpdatePoint::firstRealINSN(bb);
+		firstInsn = UpdatePoint::firstRealINSN(bb);
 		insertSelBegin(idBB, bb, codeLabel, firstInsn);
 		insertSelEnd(idBB, bb, codeLabel);
 	}
+	else{
+		insertMiddle(idBB, bb, codeLabel, middleInsn);
+		firstInsn = UpdatePoint::firstRealINSN(bb);
+		insertBegin(idBB, bb, codeLabel, firstInsn);
+		insertEnd(idBB, bb, codeLabel);
+	}
+	if(AsmGen::isDryRun()){
+		this->dryRunInsns[idBB] = AsmGen::nrOfDryRunInsns() - dryRunInsnsBefore;
+		this->dryRunChecked[idBB] = (AsmGen::nrOfDryRunChecks() != dryRunChecksBefore);
+	}
+	else if(BlockSummary::nrOfRealInstr(bb) == nrOfInstr){
+		PhaseTimer::count(STAT_BLOCKS_SKIPPED, 1);
+	}
+}
+
+/**
+ * Function to determine which basic blocks are hot.
+ * A basic block is hot if its weight is above the threshold, which is either
+ * an execution count or, written as p<percentile>, that percentile of the weights
+ * of all basic blocks of the function.
+ */
+vector<bool> GeneralCFED::findHotBlocks(const char* profileThreshold){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	vector<gcov_type> weights(nrOfBB, 0);
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		weights[(bb->index) - 2] = blockWeight(bb);
+	}
+
+	gcov_type limit = 0;
+	char* end;
+	if(profileThreshold[0] == 'p'){
+		double percentile = strtod(profileThreshold + 1, &end);
+		if((*end != '\0') || (end == profileThreshold + 1) || (percentile < 0) || (percentile > 100)){
+			throw "Wrong profileThreshold provided. Values are an execution count or p<percentile>";
+		}
+		vector<gcov_type> sorted(weights);
+		sort(sorted.begin(), sorted.end());
+		if(!sorted.empty()){
+			limit = sorted[(size_t)(percentile / 100 * (sorted.size()-1))];
+		}
+	}
+	else{
+		limit = strtoll(profileThreshold, &end, 10);
+		if((*end != '\0') || (end == profileThreshold)){
+			throw "Wrong profileThreshold provided. Values are an execution count or p<percentile>";
+		}
+	}
+
+	vector<bool> hotBlocks(nrOfBB, false);
+	for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+		hotBlocks[idBB] = (weights[idBB] > limit);
+	}
+	return hotBlocks;
+}
+
+/**
+ * Function to assign a bit of the signature register to each basic block,
+ * for the techniques that represent the successors of a basic block by their bits.
+ * On ARMv6-M, a mask that does not fit 8 bits is loaded from a literal pool,
+ * unless its bits are close enough for a MOV and an LSL. The bits are therefore
+ * numbered breadth-first from the entry block, so that the successors of a basic
+ * block get adjacent bits where they are reached first. The entry block gets bit 0.
+ * On the other targets, each basic block gets the bit of its index.
+ */
+void GeneralCFED::assignSignatureBits(vector<unsigned int>& bitOf){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	bitOf.assign(nrOfBB, 0);
+	if(ARM_ISA::getISAtarget(arm_cpu_option) != ARMv6M){
+		for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+			bitOf[idBB] = idBB;
+		}
+		return;
+	}
+
+	vector<bool> assigned(nrOfBB, false);
+	vector<unsigned int> queue;
+	unsigned int nextBit = 0;
+	if(nrOfBB != 0){
+		bitOf[0] = nextBit++;
+		assigned[0] = true;
+		queue.push_back(0);
+	}
+	for(unsigned int q = 0; q < queue.size(); q++){
+		basic_block bb = BASIC_BLOCK_FOR_FN(cfun, queue[q] + 2);
+		edge e;
+		edge_iterator ei;
+		FOR_EACH_EDGE(e, ei, bb->succs){
+			unsigned int idSucc = (e->dest)->index - 2;
+			if((idSucc < nrOfBB) && !assigned[idSucc]){
+				bitOf[idSucc] = nextBit++;
+				assigned[idSucc] = true;
+				queue.push_back(idSucc);
+			}
+		}
+	}
+	// Basic blocks that are not reachable from the entry block
+	for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+		if(!assigned[idBB]){
+			bitOf[idBB] = nextBit++;
+		}
+	}
+}
+
+/**
+ * Returns the execution count of the basic block when profile feedback
+ * (-fprofile-use) is available, its estimated frequency otherwise
+ */
+gcov_type GeneralCFED::blockWeight(basic_block bb){
+	if(profile_status_for_fn(cfun) == PROFILE_READ){
+		return bb->count;
+	}
+	return bb->frequency;
+}
+
+/**
+ * Function to give each successor of a basic block ending in a table jump its own
+ * update of the control variables, as a trampoline placed after the jump table:
+ * 	.trampolineLabel
+ * 	<update inserted by insertTableAdjust>
+ * 	B .successorLabel
+ * The entries of the jump table (and the default target of a Thumb-2 table jump)
+ * pointing to that successor are redirected to the trampoline.
+ * Successors that need no update are still reached directly.
+ */
+void GeneralCFED::insertTableTrampolines(unsigned int idBB, basic_block bb){
+	rtx_insn* jump = UpdatePoint::lastRealINSN(bb);
+	rtx_insn* tableLabel;
+	rtx_jump_table_data* table;
+	if(!tablejump_p(jump, &tableLabel, &table)){
+		return;
+	}
+
+	// All label references that can be redirected
+	vector<rtx> refs;
+	collectLabelRefs(PATTERN(jump), tableLabel, refs);
+	rtvec labels = table->get_labels();
+	for(int i = 0; i < GET_NUM_ELEM(labels); i++){
+		refs.push_back(RTVEC_ELT(labels, i));
+	}
+
+	rtx_insn* prev = table;
+	if((NEXT_INSN(prev) != 0x00) && BARRIER_P(NEXT_INSN(prev))){
+		prev = NEXT_INSN(prev);
+	}
+	edge e;
+	edge_iterator ei;
+	FOR_EACH_EDGE(e, ei, bb->succs){
+		rtx_insn* target = BB_HEAD(e->dest);
+		if(((e->dest)->index < 2) || !LABEL_P(target)){
+			continue;
+		}
+		unsigned int dryRunInsnsBefore = AsmGen::nrOfDryRunInsns();
+		AsmGen::startSequence();
+		insertTableAdjust(idBB, (e->dest)->index - 2);
+		rtx_insn* last = AsmGen::endSequence(prev, 0x00, true);
+		if(AsmGen::isDryRun()){
+			if(AsmGen::nrOfDryRunInsns() != dryRunInsnsBefore){
+				AsmGen::emitJump(target, prev, 0x00, true);
+			}
+			continue;
+		}
+		if(last == prev){
+			continue;
+		}
+		rtx_insn* trampoline = AsmGen::emitCodeLabel(insnID++, prev, 0x00, true);
+		prev = AsmGen::emitJump(target, last, 0x00, true);
+
+		for(unsigned int i = 0; i < refs.size(); i++){
+			if(label_ref_label(refs[i]) == target){
+				set_label_ref_label(refs[i], trampoline);
+				LABEL_NUSES(target)--;
+				LABEL_NUSES(trampoline)++;
+			}
+		}
+	}
+}
+
+/**
+ * Function to collect the label references in the expression,
+ * apart from the references to the jump table
+ */
+void GeneralCFED::collectLabelRefs(rtx expr, rtx_insn* tableLabel, vector<rtx>& refs){
+	if(expr == 0x00){
+		return;
+	}
+	rtx_code exprCode = (rtx_code) expr->code;
+	if(exprCode == LABEL_REF){
+		if(label_ref_label(expr) != tableLabel){
+			refs.push_back(expr);
+		}
+		return;
+	}
+	const char* format = GET_RTX_FORMAT(exprCode);
+	for(int x = 0; x < GET_RTX_LENGTH(exprCode); x++){
+		if(format[x] == 'e'){
+			collectLabelRefs(XEXP(expr, x), tableLabel, refs);
+		}
+		else if(format[x] == 'E'){
+			for(int i = 0; i < XVECLEN(expr, x); i++){
+				collectLabelRefs(XVECEXP(expr, x, i), tableLabel, refs);
+			}
+		}
+	}
 }
 
 /**
  * Function that emits a code label at the end of the current function
  * and emits the call to the CFED_Detected error handler.
+ * With detection=trap, the checks raise a trap instead and only the label is emitted.
  */
 rtx_insn* GeneralCFED::insertError(){
 	rtx_insn* prev = get_last_insn();
 	basic_block bb = BASIC_BLOCK_FOR_FN(cfun,last_basic_block_for_fn(cfun)-1);
 	rtx_insn* codeLabel = AsmGen::emitCodeLabel(insnID++, prev, bb, true);
-	AsmGen::emitCall(codeLabel);
+	// With traps no check branches to the label, so the call is left out
+	if(!AsmGen::isTrapDetection()){
+		AsmGen::emitCall(codeLabel);
+	}
 	return codeLabel;
 }
 
 /**
- * Function that counts the number of original instructions
- * in the basic block
+ * Function to reset all per-function state, keeping the allocated storage:
+ * the block summary, insn classifications and the variables of the technique.
+ * Must be called before the CFG of the function is changed.
+ */
+void GeneralCFED::startFunction(){
+	BlockSummary::clear();
+	InstrType::clearCache();
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	this->signatures.assign(nrOfBB, 0);
+	this->nrOfOrigInstr.assign(nrOfBB, 0);
+	this->insnID = get_max_uid();
+	this->firstInsnUID = this->insnID;
+	this->loopCounterReg = 0;
+	FunctionRNG::startFunction();
+	initVariables();
+}
+
+/**
+ * Function to select the registers of the technique for the current function:
+ * the fixed registers of the ISA, or with regAllocation=free the registers
+ * the function never uses. The remaining registers can hold the loop counter.
+ */
+void GeneralCFED::selectRegisters(bool freeRegisters){
+	unsigned int nrOfRegs = this->regsToUse.size();
+	vector<unsigned int> regs = freeRegisters ? isa->getUnusedRegisters() : isa->getNecessaryRegisters();
+	if((regs.size() < nrOfRegs) && freeRegisters){
+		throw "Not enough unused registers in this function for the technique, use regAllocation=fixed";
+	}
+	if(regs.size() < nrOfRegs){
+		throw "Not enough registers provided for the technique, see the registers argument";
+	}
+	this->regsToUse.assign(regs.begin(), regs.begin() + nrOfRegs);
+	this->spareRegs.assign(regs.begin() + nrOfRegs, regs.end());
+}
+
+/**
+ * Function to refuse functions with table jumps if the technique does not support them
+ */
+void GeneralCFED::checkTableJumps(){
+	if(supportsTableJumps()){
+		return;
+	}
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		if(InstrType::isTableJump(BB_END(bb))){
+			throw "Jump tables are not supported for this technique, compile with -fno-jump-tables";
+		}
+	}
+}
+
+/**
+ * Function that builds the summary of each basic block and
+ * retrieves the number of original instructions in the basic block
  */
 void GeneralCFED::countNrOfOrigInstr(){
-	// First count the number of instructions in the current basic block
+	BlockSummary::build();
+	this->nrOfOrigInstr.assign(n_basic_blocks_for_fn(cfun)-2, 0);
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) - 2;
-		unsigned int nrOfInstr = 0;
-		rtx_insn* insn;
-		FOR_BB_INSNS(bb, insn){
-			if(NONDEBUG_INSN_P(insn) && !InstrType::isUse(insn) && !InstrType::isUnspec(insn) &&
-					!InstrType::isClobber(insn) && !InstrType::isUnspecVolatile(insn)){
-				nrOfInstr++;
-			}
-		}
-		this->nrOfOrigInstr[idBB] = nrOfInstr;
+		this->nrOfOrigInstr[idBB] = BlockSummary::nrOfOrigInstr(bb);
+	}
+}
+
+/**
+ * Function to fill in the variables of the technique.
+ * Reuses the plan of a function with the same shape if the PlanCache has one,
+ * otherwise calls calcVariables and stores the resulting plan.
+ */
+void GeneralCFED::planVariables(){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	this->signatures.resize(nrOfBB);
+
+	vector<int> shape;
+	vector<int> plan;
+	PlanCache::describeFunction(shape, this->nrOfOrigInstr);
+	if(PlanCache::lookup(shape, plan)){
+		unsigned int pos = 0;
+		PlanCache::readValues(plan, pos, this->signatures);
+		loadPlan(plan, pos);
+	}
+	else{
+		FunctionRNG::startPlan(PlanCache::hash(shape));
+		calcVariables();
+		PlanCache::appendValues(plan, this->signatures);
+		savePlan(plan);
+		PlanCache::store(shape, plan);
 	}
+	FunctionRNG::startInsertion();
 }
@@ -21,9 +21,12 @@
 #include <basic-block.h>
 #include <rtl.h>
 
+#include <limits.h>
+
 #include <vector>
 
 #include "ArmISA_Functions.h"
+#include "structsHolder.h"
 
 using namespace std;
 
@@ -32,15 +35,37 @@ class GeneralCFED{
 		GeneralCFED(ARM_ISA* isa, unsigned int nrOfRegsToUse);
 		virtual ~GeneralCFED(){}
 
-		void implementTechnique(bool intraBlockDet, unsigned int selectiveLevel);
+		void implementTechnique(CFEDoptions& options);
+		bool estimateCost(CFEDoptions& options, CFEDcost& cost);
 
 	protected:
 		vector<unsigned int> signatures;
 		vector<unsigned int> regsToUse;
 		vector<unsigned int> nrOfOrigInstr;
 		ARM_ISA* isa;
+		// Whether calcVariables should assign the signatures to minimize the emitted adjust instructions
+		bool optimizeSignatures;
+		// Whether calcVariables should pick immediates with a 16-bit Thumb encoding
+		bool compactEncoding;
+
+		gcov_type blockWeight(basic_block bb);
+		void assignSignatureBits(vector<unsigned int>& bitOf);
+		void insertTableTrampolines(unsigned int idBB, basic_block bb);
 
 	private:
+		/**
+		 * Function to reset the per-function variables of the technique.
+		 * The technique object is reused for all functions of the translation unit,
+		 * so the variables are reset (keeping their allocated storage) instead of recreated.
+		 */
+		virtual void initVariables(){}
+
+		/**
+		 * Function to tell the largest number of basic blocks the technique
+		 * can protect, e.g. because of the number of bits in its signature
+		 */
+		virtual unsigned int maxNrOfBB(){ return UINT_MAX; }
+
 		/**
 		 * Function to calculate all necessary variables
 		 * E.g. signatures
@@ -87,19 +112,85 @@ class GeneralCFED{
 		 */
 		virtual void insertSetup() = 0;
 
+		/**
+		 * Function to tell whether the technique updates its control variables
+		 * conditionally (based on the condition flags) at the end of the basic block.
+		 * Only CBZ and CBNZ instructions ending such basic blocks must be split.
+		 */
+		virtual bool needsCondUpdate(unsigned int idBB, basic_block bb){ return false; }
+
+		/**
+		 * Function to insert only the verification of the signature, as done by insertBegin,
+		 * after the begin update of the basic block. Used by the loop level to check
+		 * a loop latch once every loopCheckInterval iterations.
+		 * Returns the last inserted rtx_insn.
+		 */
+		virtual rtx_insn* insertLoopCheck(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter){
+			throw "A loopCheckInterval above 1 is not supported for this technique";
+		}
+
+		/**
+		 * Function to tell whether the technique handles basic blocks ending in a table jump
+		 */
+		virtual bool supportsTableJumps(){ return false; }
+
+		/**
+		 * Function to insert the update of the control variables for the edge from a basic block
+		 * ending in a table jump to one of its successors, as needed on top of the update done
+		 * at the end of the basic block. Is called by insertTableTrampolines while a sequence
+		 * is started, so the attach points are ignored. Nothing is inserted if no update is needed.
+		 */
+		virtual void insertTableAdjust(unsigned int idBB, unsigned int idSuccs){
+			throw "Jump tables are not supported for this technique, compile with -fno-jump-tables";
+		}
+
 		/**
 		 * Function to insert the infinite while loop as CFE detection indicator
 		 * returns the created codeLabel
 		 */
 		rtx_insn* insertError();
 
+		void startFunction();
+		void selectRegisters(bool freeRegisters);
+		void checkTableJumps();
 		void countNrOfOrigInstr();
+		void planVariables();
+
+		/**
+		 * Functions to append the variables computed by calcVariables
+		 * (apart from the signatures) to a plan and to restore them from it
+		 */
+		virtual void savePlan(vector<int>& plan){}
+		virtual void loadPlan(vector<int>& plan, unsigned int& pos){}
 
 		unsigned int insnID;
+		unsigned int firstInsnUID;
+		unsigned int loopCounterReg;
+		vector<unsigned int> spareRegs;			// Registers available to the technique that it does not use
+
+		// Per basic block: the number of instructions inserted and whether a check was inserted during a dry run
+		vector<unsigned int> dryRunInsns;
+		vector<bool> dryRunChecked;
 
 		// Functions to clearly separate the functionality of the different selective levels
+		void implementInAllBB(CFEDoptions& options, rtx_insn* codeLabel);
 		void fullyImplementInAllBB(bool intraBlockDet, rtx_insn* codeLabel);
 		void selectiveImplementInAllBB(bool intraBlockDet, rtx_insn* codeLabel);
+		void profileImplementInAllBB(bool intraBlockDet, const char* profileThreshold, rtx_insn* codeLabel);
+		void loopImplementInAllBB(bool intraBlockDet, unsigned int loopCheckInterval, rtx_insn* codeLabel);
+		void implementInBB(unsigned int idBB, basic_block bb, bool intraBlockDet, bool selective, rtx_insn* codeLabel);
+
+		static void collectLabelRefs(rtx expr, rtx_insn* tableLabel, vector<rtx>& refs);
+
+		// Functions to find the hot basic blocks for the profile-guided selective level
+		vector<bool> findHotBlocks(const char* profileThreshold);
+
+		// Functions for the loop-aware selective level
+		// Estimated cycles of a check (CMP and BNE not taken) and of the loop counter (SUB, CMP and BNE taken)
+		static constexpr double loopCheckCycles = 2;
+		static constexpr double loopCounterCycles = 4;
+		void insertLoopCounterCheck(unsigned int idBB, basic_block bb, unsigned int loopCheckInterval, rtx_insn* codeLabel, rtx_insn* attachBefore);
+		void reportLoopLatency(unsigned int loopCheckInterval, double cyclesSaved);
 };
 
 
@@ -0,0 +1,231 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "PlanCache.h"
+#include "FunctionRNG.h"
+#include "ArmISA_Functions.h"
+#include "InstrType.h"
+#include "BlockSummary.h"
+
+map<uint64_t, PlanEntry> PlanCache::entries;
+string PlanCache::directory;
+string PlanCache::technique;
+bool PlanCache::intraBlockDet = false;
+unsigned int PlanCache::selectiveLevel = 0;
+bool PlanCache::optimizeSignatures = false;
+bool PlanCache::compactEncoding = false;
+
+/**
+ * Function to enable the on-disk tier, plans are stored in the given directory
+ */
+void PlanCache::setDirectory(const char* dir){
+	directory = dir;
+	if(!directory.empty()){
+		// Shared between users and build agents, the umask restricts it where needed
+		mkdir(directory.c_str(), 0777);
+	}
+}
+
+/**
+ * Function to set the technique and options the next plans are computed for
+ */
+void PlanCache::setTechnique(const char* technique, CFEDoptions& options){
+	PlanCache::technique = technique;
+	PlanCache::intraBlockDet = options.intraBlockDet;
+	PlanCache::selectiveLevel = options.selectiveLevel;
+	PlanCache::optimizeSignatures = options.optimizeSignatures;
+	PlanCache::compactEncoding = options.compactEncoding;
+}
+
+/**
+ * Function to describe everything calcVariables of a technique depends on:
+ * the technique, ISA, options and seed, and per basic block its
+ * successors, predecessors and instruction counts.
+ * With optimized signatures the block and edge frequencies are included as well.
+ * Must be called after the block summary has been built.
+ */
+void PlanCache::describeFunction(vector<int>& shape, vector<unsigned int>& nrOfOrigInstr){
+	uint64_t seed = FunctionRNG::getSeed();
+	shape.clear();
+	shape.push_back(version);
+	shape.push_back(ARM_ISA::getISAtarget(arm_cpu_option));
+	shape.push_back(intraBlockDet);
+	shape.push_back(selectiveLevel);
+	shape.push_back(optimizeSignatures);
+	shape.push_back(compactEncoding);
+	shape.push_back((int) seed);
+	shape.push_back((int) (seed >> 32));
+	shape.push_back(technique.size());
+	for(unsigned int i = 0; i < technique.size(); i++){
+		shape.push_back(technique[i]);
+	}
+	shape.push_back(n_basic_blocks_for_fn(cfun));
+	shape.push_back(last_basic_block_for_fn(cfun));
+
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		shape.push_back(bb->index);
+		shape.push_back(InstrType::isExitBlock(bb));
+		shape.push_back(nrOfOrigInstr[bb->index - 2]);
+		shape.push_back(BlockSummary::nrOfVerifiableInstr(bb));
+		edge e;
+		edge_iterator ei;
+		shape.push_back(EDGE_COUNT(bb->succs));
+		FOR_EACH_EDGE(e, ei, bb->succs){
+			shape.push_back(e->dest->index);
+			if(optimizeSignatures){
+				shape.push_back(e->probability);
+			}
+		}
+		if(optimizeSignatures){
+			shape.push_back(bb->frequency);
+			shape.push_back((int) bb->count);
+			shape.push_back((int) (bb->count >> 32));
+		}
+		shape.push_back(EDGE_COUNT(bb->preds));
+		FOR_EACH_EDGE(e, ei, bb->preds){
+			shape.push_back(e->src->index);
+		}
+	}
+}
+
+/**
+ * FNV-1a hash of the shape, used as key of the cache
+ */
+uint64_t PlanCache::hash(vector<int>& shape){
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for(unsigned int i = 0; i < shape.size(); i++){
+		hash = (hash ^ (uint32_t) shape[i]) * 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+/**
+ * Function to look up the plan of the given shape,
+ * first in memory and then on disk
+ * @return bool True if a plan was found and copied into plan
+ */
+bool PlanCache::lookup(vector<int>& shape, vector<int>& plan){
+	uint64_t key = hash(shape);
+	map<uint64_t, PlanEntry>::iterator it = entries.find(key);
+	if(it != entries.end()){
+		if(it->second.shape != shape){
+			return false;
+		}
+		plan = it->second.plan;
+		return true;
+	}
+	if(!directory.empty() && loadFile(key, shape, plan)){
+		PlanEntry& entry = entries[key];
+		entry.shape = shape;
+		entry.plan = plan;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Function to store the plan of the given shape in memory and, if enabled, on disk
+ */
+void PlanCache::store(vector<int>& shape, vector<int>& plan){
+	uint64_t key = hash(shape);
+	PlanEntry& entry = entries[key];
+	entry.shape = shape;
+	entry.plan = plan;
+	if(!directory.empty()){
+		storeFile(key, shape, plan);
+	}
+}
+
+/**
+ * Function to read the next single value of the plan
+ */
+int PlanCache::readValue(vector<int>& plan, unsigned int& pos){
+	if(pos >= plan.size()){
+		throw "Plan cache entry is corrupt";
+	}
+	return plan[pos++];
+}
+
+// ----------------------- Private Section -------------------------- \\
+
+/**
+ * Function to create the name of the file holding the plan with the given key
+ */
+string PlanCache::createFileName(uint64_t key){
+	char name[32];
+	snprintf(name, 32, "/%016llx.plan", (unsigned long long) key);
+	return directory + name;
+}
+
+/**
+ * Function to load a plan from disk.
+ * The file holds a header (magic, version, shape size, plan size)
+ * followed by the shape and the plan, and is mapped into memory to read it.
+ * Files that do not match the shape exactly are ignored.
+ */
+bool PlanCache::loadFile(uint64_t key, vector<int>& shape, vector<int>& plan){
+	int fd = open(createFileName(key).c_str(), O_RDONLY);
+	if(fd == -1){
+		return false;
+	}
+	struct stat st;
+	if((fstat(fd, &st) != 0) || (st.st_size < 4*sizeof(int))){
+		close(fd);
+		return false;
+	}
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED){
+		return false;
+	}
+
+	const int* data = (const int*) map;
+	size_t nrOfValues = st.st_size / sizeof(int);
+	bool found = (data[0] == 0x4C504643) && (data[1] == version)
+			&& (data[2] == shape.size()) && (4 + (size_t) data[2] + (size_t) data[3] == nrOfValues)
+			&& (memcmp(data + 4, &shape[0], shape.size()*sizeof(int)) == 0);
+	if(found){
+		plan.assign(data + 4 + data[2], data + nrOfValues);
+	}
+	munmap(map, st.st_size);
+	return found;
+}
+
+/**
+ * Function to write a plan to disk.
+ * Written to a temporary file first and then renamed, so concurrent
+ * compilations never see a partially written plan.
+ */
+void PlanCache::storeFile(uint64_t key, vector<int>& shape, vector<int>& plan){
+	string fileName = createFileName(key);
+	string tempName = fileName + "." + to_string(getpid()) + ".tmp";
+	FILE* fp = fopen(tempName.c_str(), "wb");
+	if(fp == NULL){
+		return;
+	}
+	int header[4] = {0x4C504643, version, (int) shape.size(), (int) plan.size()};
+	bool written = (fwrite(header, sizeof(int), 4, fp) == 4)
+			&& (fwrite(&shape[0], sizeof(int), shape.size(), fp) == shape.size())
+			&& (plan.empty() || (fwrite(&plan[0], sizeof(int), plan.size(), fp) == plan.size()));
+	if((fclose(fp) == 0) && written){
+		rename(tempName.c_str(), fileName.c_str());
+	}
+	else{
+		remove(tempName.c_str());
+	}
+}
@@ -0,0 +1,105 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * Header file for the PlanCache class.
+ *
+ * Contains the prototypes of the methods used to cache the protection plan
+ * of a function, i.e. everything a technique computes in calcVariables.
+ * A plan is keyed by the shape of the CFG (edges, instruction counts) and
+ * the selected technique, ISA and options.
+ *
+ * Two tiers are used:
+ * 	- In memory, so identical functions of a translation unit share their plan
+ * 	- Optionally on disk, one memory-mapped file per plan in the directory
+ * 	  given by the planCache argument, so repeated builds reuse plans
+ */
+
+#ifndef CFED_TECHNIQUES_PLANCACHE_H_
+#define CFED_TECHNIQUES_PLANCACHE_H_
+
+#include <gcc-plugin.h>
+#include <basic-block.h>
+#include <rtl.h>
+
+#include <stdint.h>
+
+#include <vector>
+#include <map>
+#include <string>
+
+#include "structsHolder.h"
+
+using namespace std;
+
+/**
+ * Struct holding one cached plan
+ * Contains:
+ * 	- The shape it was computed for, to reject hash collisions
+ * 	- The plan itself
+ */
+struct PlanEntry{
+	vector<int> shape;
+	vector<int> plan;
+};
+
+class PlanCache{
+	public:
+		static void setDirectory(const char* dir);
+		static void setTechnique(const char* technique, CFEDoptions& options);
+
+		static void describeFunction(vector<int>& shape, vector<unsigned int>& nrOfOrigInstr);
+		static uint64_t hash(vector<int>& shape);
+
+		static bool lookup(vector<int>& shape, vector<int>& plan);
+		static void store(vector<int>& shape, vector<int>& plan);
+
+		/**
+		 * Function to append the values to the plan, preceded by their number
+		 */
+		template<typename T>
+		static void appendValues(vector<int>& plan, vector<T>& values){
+			plan.push_back(values.size());
+			for(unsigned int i = 0; i < values.size(); i++){
+				plan.push_back((int) values[i]);
+			}
+		}
+
+		/**
+		 * Function to read values appended by appendValues, starting at pos
+		 */
+		template<typename T>
+		static void readValues(vector<int>& plan, unsigned int& pos, vector<T>& values){
+			unsigned int size = readValue(plan, pos);
+			if(size > plan.size() - pos){
+				throw "Plan cache entry is corrupt";
+			}
+			values.assign(size, 0);
+			for(unsigned int i = 0; i < size; i++){
+				values[i] = (T) plan[pos++];
+			}
+		}
+
+		static int readValue(vector<int>& plan, unsigned int& pos);
+
+	private:
+		static const int version = 4;
+
+		static map<uint64_t, PlanEntry> entries;
+		static string directory;
+		static string technique;
+		static bool intraBlockDet;
+		static unsigned int selectiveLevel;
+		static bool optimizeSignatures;
+		static bool compactEncoding;
+
+		static string createFileName(uint64_t key);
+		static bool loadFile(uint64_t key, vector<int>& shape, vector<int>& plan);
+		static void storeFile(uint64_t key, vector<int>& shape, vector<int>& plan);
+};
+
+
+#endif /* CFED_TECHNIQUES_PLANCACHE_H_ */
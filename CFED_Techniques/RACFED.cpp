@@ -10,93 +10,249 @@
 #include <tree.h>
 
 #include <stdlib.h>
+#include <algorithm>
 
 #include "RACFED.h"
+#include "PlanCache.h"
 #include "AsmGen.h"
 #include "UpdatePoint.h"
 #include "InstrType.h"
+#include "FunctionRNG.h"
 
 /**
  * Constructor, initializes necessary variables
- * Some values dependent on the ISA of the current CPU
  */
 RACFED::RACFED(ARM_ISA* isa, unsigned int nrOfRegsToUse)
 	:GeneralCFED(isa, nrOfRegsToUse){
-	vector<int>tempInt(n_basic_blocks_for_fn(cfun)-2, 0);
-	this->intraBlockAddValues = tempInt;								// Making sure the vector 0 filled.
-	this->subRanPrevValues.reserve(n_basic_blocks_for_fn(cfun)-2);		// Making sure the vector exists for all needed spaces
-	switch(ARM_ISA::getISAtarget(arm_cpu_option)){
-		case ARMv7M:
-			this->CMPlimit = 254;
-			this->subRanPrevValLimit = 1500;
-			this->sigRegLowerLimit = -2341;
-			this->sigRegUpperLimit = 4095;
-			break;
-		case ARMv6M:
-		default:
-			this->CMPlimit = 254;
-			this->subRanPrevValLimit = 255;
-			this->sigRegLowerLimit = 0;
-			this->sigRegUpperLimit = 255;
+}
+
+/**
+ * Function to reset the per-function variables
+ * The limits of the values depend on the ISA of the current CPU. With
+ * encoding=compact, the ARMv6-M limits are used on every target, so all
+ * values fit the 8-bit immediates of the 16-bit ADDS, SUBS and CMP.
+ */
+void RACFED::initVariables(){
+	if((ARM_ISA::getISAtarget(arm_cpu_option) == ARMv7M) && !this->compactEncoding){
+		this->CMPlimit = 254;
+		this->subRanPrevValLimit = 1500;
+		this->sigRegLowerLimit = -2341;
+		this->sigRegUpperLimit = 4095;
+	}
+	else{
+		this->CMPlimit = 254;
+		this->subRanPrevValLimit = 255;
+		this->sigRegLowerLimit = 0;
+		this->sigRegUpperLimit = 255;
 	}
+	this->intraBlockAddValues.assign(n_basic_blocks_for_fn(cfun)-2, 0);		// Making sure the vector 0 filled.
 }
 
 /**
  * Function to calculate / assign the
  * 	- compile-time signatures for each basic block
  * 	- subRanPrevVal values for each basic block
+ *
+ * The signatures are taken from a shuffled list of CMP immediates, so they are
+ * unique by construction. The subRanPrevVal values are then assigned in order of
+ * decreasing signature, each picking a random free sum in its allowed window.
+ * A block with signature s can reach at least as many sums as there are larger
+ * signatures competing for that window, so a free sum always exists and the
+ * whole assignment runs in time linear in the number of basic blocks.
  */
 void RACFED::calcVariables(){
+	unsigned int nrOfBB = n_basic_blocks_for_fn(cfun)-2;
+	vector<unsigned int> candidates = collectSignatureCandidates(nrOfBB);
+	this->signatures.assign(nrOfBB, 0);
+	this->subRanPrevValues.assign(nrOfBB, 0);
+
+	// Assign signatures, remember which block owns which signature
+	vector<int> blockOfSignature(sigRegUpperLimit, -1);
+	for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+		signatures[idBB] = candidates[idBB];
+		blockOfSignature[candidates[idBB]] = idBB;
+	}
+
+	// With optimized signatures, try to make the adjust of the most frequent edges 0
+	if(this->optimizeSignatures && (nrOfBB <= CMPlimit) && optimizeSubRanPrev(nrOfBB)){
+		return;
+	}
+
+	// Assign subRanPrevValues, most constrained (= largest) signature first
+	vector<bool> usedSums(sigRegUpperLimit, false);
+	for(int sig = sigRegUpperLimit-1; sig > 0; sig--){
+		if(blockOfSignature[sig] != -1){
+			subRanPrevValues[blockOfSignature[sig]] = pickSubRanPrev(sig, usedSums);
+		}
+	}
+}
+
+/**
+ * Function to assign the subRanPrevVal values for sigAssignment=optimized.
+ * The adjust of an edge is 0, and is not emitted, if the sum of the successor
+ * equals the signature of the predecessor (without intra-block values):
+ * 	signature(succ) + subRanPrevVal(succ) = signature(pred)
+ * As the sums must stay unique, each basic block can only be the zero-adjust
+ * successor of one predecessor and vice versa. The candidate edges are matched
+ * greedily, most frequent edge first. On ARMv6-M only the taken edge of a
+ * conditional branch is a candidate, as the adjust of the fallthrough edge
+ * is emitted after the taken one. All other sums are picked at random
+ * in [1, CMPlimit], so every remaining adjust fits ADDS/SUBS #imm8.
+ * Only used if all signatures are 8-bit values.
+ * @return bool False if no valid assignment was found, the random one is used then
+ */
+bool RACFED::optimizeSubRanPrev(unsigned int nrOfBB){
+	// Collect the candidate edges
+	vector<RACFEDedge> edges;
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) - 2;
-		unsigned int tempSig = 0;
-		unsigned int tempSubRanPrev = 0;
-		do{
-			// Assign signature
-			do{
-				tempSig = (rand() % CMPlimit) + 1;
-			}while(!isUniqueSignature(tempSig));
-			signatures[idBB] = tempSig;
-			// Assign subRanPrevValue
-			tempSubRanPrev = rand() % subRanPrevValLimit;
-		}while(!isUniqueSum(idBB, tempSubRanPrev));
-		subRanPrevValues[idBB] = tempSubRanPrev;
+		if(InstrType::isExitBlock(bb)){
+			continue;
+		}
+		edge e;
+		edge_iterator ei;
+		FOR_EACH_EDGE(e, ei, bb->succs){
+			if((e->dest->index < 2) || (e->dest == bb)){
+				continue;
+			}
+			unsigned int idSuccs = (e->dest->index) - 2;
+			if((ARM_ISA::getISAtarget(arm_cpu_option) != ARMv7M) && (EDGE_COUNT(bb->succs) == 2) && (idSuccs == idBB+1)){
+				continue;
+			}
+			RACFEDedge candidate = {idBB, idSuccs, (double) blockWeight(bb) * e->probability};
+			edges.push_back(candidate);
+		}
 	}
+	stable_sort(edges.begin(), edges.end(), isMoreFrequent);
+
+	// Match the edges, most frequent first
+	vector<bool> usedSums(CMPlimit+1, false);
+	vector<bool> hasSum(nrOfBB, false);
+	for(unsigned int i = 0; i < edges.size(); i++){
+		unsigned int sum = signatures[edges[i].srcBBId];
+		if(!hasSum[edges[i].destBBId] && !usedSums[sum]){
+			subRanPrevValues[edges[i].destBBId] = sum - signatures[edges[i].destBBId];
+			usedSums[sum] = true;
+			hasSum[edges[i].destBBId] = true;
+		}
+	}
+
+	// Pick a random free sum for the other basic blocks, a subRanPrevVal of 0 is not allowed
+	for(unsigned int idBB = 0; idBB < nrOfBB; idBB++){
+		if(hasSum[idBB]){
+			continue;
+		}
+		unsigned int offset = FunctionRNG::next() % CMPlimit;
+		for(unsigned int i = 0; (i < CMPlimit) && !hasSum[idBB]; i++){
+			unsigned int sum = 1 + ((offset + i) % CMPlimit);
+			if(!usedSums[sum] && (sum != signatures[idBB])){
+				subRanPrevValues[idBB] = sum - signatures[idBB];
+				usedSums[sum] = true;
+				hasSum[idBB] = true;
+			}
+		}
+		if(!hasSum[idBB]){
+			subRanPrevValues.assign(nrOfBB, 0);
+			return false;
+		}
+	}
+	return true;
 }
 
 /**
- * Function to determine whether or not the current
- * candidate signature is unique in the function
+ * Function to order the candidate zero-adjust edges, most frequent first
  */
-bool RACFED::isUniqueSignature(unsigned int signature){
-	bool unique = true;
-	for(int i = 0; i < n_basic_blocks_for_fn(cfun)-2; i++){
-		if(signature == signatures[i]){
-			unique = false;
+bool RACFED::isMoreFrequent(const RACFEDedge& first, const RACFEDedge& second){
+	return first.weight > second.weight;
+}
+
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void RACFED::savePlan(vector<int>& plan){
+	PlanCache::appendValues(plan, this->subRanPrevValues);
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void RACFED::loadPlan(vector<int>& plan, unsigned int& pos){
+	PlanCache::readValues(plan, pos, this->subRanPrevValues);
+}
+
+/**
+ * Function to collect the candidate compile-time signatures in random order
+ * 	- first all 8-bit values [1, CMPlimit], usable on every target
+ * 	- then, on ARMv7-M only, the shifted 8-bit values below sigRegUpperLimit which
+ * 	  are still valid Thumb-2 CMP immediates. These are only used when the function
+ * 	  has more basic blocks than there are 8-bit values.
+ */
+vector<unsigned int> RACFED::collectSignatureCandidates(unsigned int nrOfBB){
+	vector<unsigned int> candidates;
+	for(unsigned int value = 1; value <= CMPlimit; value++){
+		candidates.push_back(value);
+	}
+	shuffle(candidates, 0);
+
+	if((nrOfBB > candidates.size()) && (ARM_ISA::getISAtarget(arm_cpu_option) == ARMv7M)){
+		unsigned int nrOfNarrow = candidates.size();
+		for(unsigned int value = 256; value < (unsigned int)sigRegUpperLimit; value++){
+			unsigned int significant = value;
+			while((significant & 1) == 0){
+				significant >>= 1;
+			}
+			if(significant <= 255){
+				candidates.push_back(value);
+			}
 		}
+		shuffle(candidates, nrOfNarrow);
+	}
+
+	if(nrOfBB > candidates.size()){
+		throw "RACFED: function has more basic blocks than unique signatures available for this target";
 	}
-	return unique;
+	return candidates;
 }
 
 /**
- * Function to determine whether or not the sum of
- * the current candidate subRanPrevVal and compile-time signature
- * is unique in the function
+ * Function to shuffle (Fisher-Yates) the elements of the vector
+ * from position start onwards
  */
-bool RACFED::isUniqueSum(unsigned int idBB, unsigned int subRanPrevValue){
-	bool unique = true;
-	unsigned int ownSum = signatures[idBB] + subRanPrevValue;
-	for(int i = 0; i < idBB; i++){
-		unsigned int existingSum = signatures[i] + subRanPrevValues[i];
-		if (ownSum == existingSum){
-			unique = false;
-		}
+void RACFED::shuffle(vector<unsigned int>& values, unsigned int start){
+	for(unsigned int i = values.size(); i > start+1; i--){
+		unsigned int j = start + (FunctionRNG::next() % (i - start));
+		unsigned int temp = values[i-1];
+		values[i-1] = values[j];
+		values[j] = temp;
+	}
+}
+
+/**
+ * Function to pick a subRanPrevVal for the given signature so that
+ * the sum of both is unique in the function and in range.
+ * Starts at a random sum in the allowed window and probes linearly,
+ * so it inspects at most subRanPrevValLimit sums.
+ */
+unsigned int RACFED::pickSubRanPrev(unsigned int signature, vector<bool>& usedSums){
+	int lowestSum = signature;
+	int highestSum = signature + subRanPrevValLimit - 1;
+	if(lowestSum <= sigRegLowerLimit){
+		lowestSum = sigRegLowerLimit + 1;
+	}
+	if(highestSum >= sigRegUpperLimit){
+		highestSum = sigRegUpperLimit - 1;
 	}
-	if(!sigRegValueInRange(ownSum)){
-		unique = false;
+	unsigned int windowSize = highestSum - lowestSum + 1;
+	unsigned int offset = FunctionRNG::next() % windowSize;
+	for(unsigned int i = 0; i < windowSize; i++){
+		int sum = lowestSum + ((offset + i) % windowSize);
+		if(!usedSums[sum]){
+			usedSums[sum] = true;
+			return sum - signature;
+		}
 	}
-	return unique;
+	throw "RACFED: no unique signature sum left";
 }
 
 /**
@@ -138,7 +294,7 @@ int RACFED::assignIntraBlockValue(unsigned int idBB){
 	int currValCandidate = 0;
 	int candidate = 0;
 	do{
-		candidate = (rand() % (sigRegUpperLimit + abs(sigRegLowerLimit))) -(sigRegUpperLimit + abs(sigRegLowerLimit))/2; // Random value between [-2000 and 4000[
+		candidate = (FunctionRNG::next() % (sigRegUpperLimit + abs(sigRegLowerLimit))) -(sigRegUpperLimit + abs(sigRegLowerLimit))/2; // Random value between [-2000 and 4000[
 		currValCandidate = currVal + candidate;
 	}while(!sigRegValueInRange(currValCandidate) || (candidate == 0) );
 	// Validate that the overall signature value remains within [-2341, 4095] because of limits of ADDW and SUBW instructions
@@ -218,6 +374,23 @@ void RACFED::insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLab
 	}
 }
 
+/**
+ * Function to insert only the verification of the signature register,
+ * after the update at the beginning of a loop latch
+ * 	CMP r11, #<compileTimeSignature>
+ * 	BNE .codeLabel
+ */
+rtx_insn* RACFED::insertLoopCheck(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter){
+	switch(ARM_ISA::getISAtarget(arm_cpu_option)){
+		case ARMv7M:
+			attachAfter = AsmGen::emitCmpRegInt(regsToUse[0], signatures[idBB], attachAfter, bb, true);
+			return AsmGen::emitBne(codeLabel, attachAfter, bb, true);
+		case ARMv6M:
+		default:
+			return AsmGen::emitBne(regsToUse[0], signatures[idBB], codeLabel, attachAfter, bb, true);
+	}
+}
+
 /**
  * Function to insert the necessary inter-block CFE detection instructions
  * in the middle of each basic block
@@ -259,7 +432,20 @@ void RACFED::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 
 	    rtx_insn* lastInsn = UpdatePoint::lastRealINSN(bb);
         unsigned int returnVal = 0;
-	    if (nrOfOrigInstr[idBB] == 0 && !InstrType::isExitBlock(bb)){
+	    if(InstrType::isTableJump(lastInsn)){
+	    	// Adjust towards the most frequent successor, the others get a trampoline
+	    	edge mostFrequent = EDGE_SUCC(bb, 0);
+	    	FOR_EACH_EDGE(e, ei, bb->succs){
+	    		if(e->probability > mostFrequent->probability){
+	    			mostFrequent = e;
+	    		}
+	    	}
+	    	unsigned int baseId = (mostFrequent->dest)->index - 2;
+	    	insertAdjust(idBB, baseId, lastInsn, bb, false);
+	    	this->tableSigVal = signatures[baseId] + subRanPrevValues[baseId];
+	    	insertTableTrampolines(idBB, bb);
+	    }
+	    else if (nrOfOrigInstr[idBB] == 0 && !InstrType::isExitBlock(bb)){
 		    lastInsn == BB_END(bb);
 		    insertAdjust(idBB, falseId, lastInsn, bb, true);
 	    }
@@ -287,16 +473,24 @@ void RACFED::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 			// or if the second instructions is not a 'use' rtx
 			//if((nrOfOrigInstr[idBB] > 2)||((nrOfOrigInstr[idBB] == 2) && (!UpdatePoint::isUse(getPrevInsn(lastInsn))))){
 	    	if( nrOfOrigInstr[idBB] > 1 ){
-				returnVal = rand() % 254;
+				// With optimized signatures, the current value is checked if possible, so no adjust is needed
+				int currSigVal = signatures[idBB] + intraBlockAddValues[idBB];
+				if(this->optimizeSignatures && (currSigVal >= 0) && (currSigVal < 254)){
+					returnVal = currSigVal;
+				}
+				else{
+					returnVal = FunctionRNG::next() % 254;
+				}
 				rtx_insn* prev = insertAdjustEnd(idBB, returnVal, lastInsn, bb);
+				bool after = (prev != lastInsn);
 				switch(ARM_ISA::getISAtarget(arm_cpu_option)){
 					case ARMv7M:
-						prev = AsmGen::emitCmpRegInt(regsToUse[0], returnVal, prev, bb, true);
+						prev = AsmGen::emitCmpRegInt(regsToUse[0], returnVal, prev, bb, after);
 						AsmGen::emitBne(codeLabel, prev, bb, true);
 						break;
 					case ARMv6M:
 					default:
-						AsmGen::emitBne(regsToUse[0], returnVal, codeLabel, prev, bb, true);
+						AsmGen::emitBne(regsToUse[0], returnVal, codeLabel, prev, bb, after);
 						break;
 				}
 
@@ -325,55 +519,98 @@ void RACFED::insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel
 
 /**
  * Emits ADD r11, #<AdjustValue>
+ * Nothing is emitted if the AdjustValue is 0, lastInsn is returned then
  */
 rtx_insn* RACFED::insertAdjust(unsigned int idBB, unsigned int idSuccs, rtx_insn* lastInsn, basic_block bb, bool after){
 	int currSigVal = signatures[idBB] + intraBlockAddValues[idBB];
 	unsigned int nextVal = signatures[idSuccs] + subRanPrevValues[idSuccs];
 	int adjustVal = nextVal - currSigVal;
+	if(adjustVal == 0){
+		return lastInsn;
+	}
 	return AsmGen::emitAddRegInt(regsToUse[0], adjustVal, lastInsn, bb, after);
 }
 
+/**
+ * Emits ADD r11, #<AdjustValue> in the trampoline towards a successor of a table jump
+ * Nothing is emitted if the AdjustValue is 0
+ */
+void RACFED::insertTableAdjust(unsigned int idBB, unsigned int idSuccs){
+	int adjustVal = (signatures[idSuccs] + subRanPrevValues[idSuccs]) - tableSigVal;
+	if(adjustVal != 0){
+		AsmGen::emitAddRegInt(regsToUse[0], adjustVal, 0x00, 0x00, true);
+	}
+}
+
 /**
  * Emits ADD r11, #<AdjustValue>
  * For use in exit basic blocks only
+ * Nothing is emitted if the AdjustValue is 0, lastInsn is returned then
  */
 rtx_insn* RACFED::insertAdjustEnd(unsigned int idBB, unsigned int returnVal, rtx_insn* lastInsn, basic_block bb){
 	int currSigVal = signatures[idBB] + intraBlockAddValues[idBB];
 	int adjustVal = returnVal - currSigVal;
+	if(adjustVal == 0){
+		return lastInsn;
+	}
 	return AsmGen::emitAddRegInt(regsToUse[0], adjustVal, lastInsn, bb, false);
 }
 
 /**
  * Emits ADD<cond> r11, #<AdjustValue>
+ * Nothing is emitted if the AdjustValue is 0, lastInsn is returned then
  */
 rtx_insn* RACFED::insertCondAdjust(unsigned int idBB, unsigned int idSuccs, enum rtx_code condition, rtx_insn* lastInsn, basic_block bb){
 	int currSigVal = signatures[idBB] + intraBlockAddValues[idBB];
 	unsigned int nextVal = signatures[idSuccs] + subRanPrevValues[idSuccs];
 	int adjustVal = nextVal - currSigVal;
+	if(adjustVal == 0){
+		return lastInsn;
+	}
 	return AsmGen::emitCondAddRegInt(regsToUse[0], adjustVal, condition, lastInsn, bb, false);
 }
 
 /**
- * Emits ADD r11, #<AdjustValue>
+ * Emits ADD r11, #<AdjustValue>, if the AdjustValue is not 0
  * For use with ARMv6-M only
  */
 int RACFED::insertTrueAdjust(unsigned int idBB, unsigned int idSuccs, rtx_insn* condJumpInsn, basic_block bb){
 	int currSigVal = signatures[idBB] + intraBlockAddValues[idBB];
 	unsigned int nextVal = signatures[idSuccs] + subRanPrevValues[idSuccs];
 	int adjustVal = nextVal - currSigVal;
-	AsmGen::emitAddRegInt(regsToUse[0], adjustVal, condJumpInsn, bb, false);
+	if(adjustVal != 0){
+		AsmGen::emitAddRegInt(regsToUse[0], adjustVal, condJumpInsn, bb, false);
+	}
 	return adjustVal;
 }
 
 /**
- * Emits ADD r11, #<AdjustValue>
+ * Emits ADD r11, #<AdjustValue>, if the AdjustValue is not 0
  * For use with ARMv6-M only
  */
 void RACFED::insertFalseAdjust(unsigned int idBB, unsigned int idSuccs, int adjustValTrue, rtx_insn* condJumpInsn, basic_block bb){
 	int currSigVal = signatures[idBB] + intraBlockAddValues[idBB];
 	unsigned int nextVal = signatures[idSuccs] + subRanPrevValues[idSuccs];
 	int adjustVal = nextVal - currSigVal - adjustValTrue;
-	AsmGen::emitAddRegInt(regsToUse[0], adjustVal, condJumpInsn, bb, true);
+	if(adjustVal != 0){
+		AsmGen::emitAddRegInt(regsToUse[0], adjustVal, condJumpInsn, bb, true);
+	}
+}
+
+/**
+ * RACFED updates the signature register conditionally (ADD<cond>)
+ * at the end of every basic block ending in a conditional branch
+ */
+bool RACFED::needsCondUpdate(unsigned int idBB, basic_block bb){
+	return true;
+}
+
+/**
+ * RACFED handles table jumps: the successors that need another adjust
+ * than the most frequent one get a trampoline
+ */
+bool RACFED::supportsTableJumps(){
+	return true;
 }
 
 /**
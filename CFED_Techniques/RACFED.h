@@ -30,7 +30,10 @@ class RACFED : public GeneralCFED{
 		~RACFED(){}
 
 	private:
+		void initVariables();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -38,17 +41,27 @@ class RACFED : public GeneralCFED{
 		void insertMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
 		void insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 		void insertSetup();
+		bool supportsTableJumps();
+
+		bool needsCondUpdate(unsigned int idBB, basic_block bb);
 
 		// Selective methods
 		void insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore);
 		void insertSelMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
 		void insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
+		rtx_insn* insertLoopCheck(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
+		void insertTableAdjust(unsigned int idBB, unsigned int idSuccs);
+
 		vector<unsigned int> subRanPrevValues;
 		vector<int> intraBlockAddValues;
+		int tableSigVal;				// Value of the signature register at the current table jump
 
-		bool isUniqueSignature(unsigned int signature);
-		bool isUniqueSum(unsigned int idBB, unsigned int subRanPrevValue);
+		vector<unsigned int> collectSignatureCandidates(unsigned int nrOfBB);
+		void shuffle(vector<unsigned int>& values, unsigned int start);
+		unsigned int pickSubRanPrev(unsigned int signature, vector<bool>& usedSums);
+		bool optimizeSubRanPrev(unsigned int nrOfBB);
+		static bool isMoreFrequent(const RACFEDedge& first, const RACFEDedge& second);
 		int assignIntraBlockValue(unsigned int idBB);
 
 		rtx_insn* getPrevInsn(rtx_insn* insn);
@@ -9,8 +9,10 @@
 #include <rtl.h>
 
 #include "RSCFC.h"
+#include "PlanCache.h"
 #include "primeNumbers.h"
 #include "AsmGen.h"
+#include "BlockSummary.h"
 #include "UpdatePoint.h"
 #include "InstrType.h"
 
@@ -22,6 +24,21 @@ RSCFC::RSCFC(ARM_ISA* isa, unsigned int nrOfRegsToUse, bool intraBlockDet)
 	this->intraBlockDet = intraBlockDet;
 }
 
+/**
+ * Function to reset the per-function variables
+ */
+void RSCFC::initVariables(){
+	CFGLocator.clear();
+}
+
+/**
+ * Function to tell the largest number of basic blocks RSCFC can protect:
+ * the 32-bit signatures hold one bit per basic block plus one
+ */
+unsigned int RSCFC::maxNrOfBB(){
+	return 31;
+}
+
 /**
  * Function to calculate / assign the
  *  - compile-time signatures for each basic block
@@ -47,6 +64,22 @@ void RSCFC::calcVariables(){
 	}
 }
 
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void RSCFC::savePlan(vector<int>& plan){
+	PlanCache::appendValues(plan, this->nrOfVerifiableInstructions);
+	PlanCache::appendValues(plan, this->CFGLocator);
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void RSCFC::loadPlan(vector<int>& plan, unsigned int& pos){
+	PlanCache::readValues(plan, pos, this->nrOfVerifiableInstructions);
+	PlanCache::readValues(plan, pos, this->CFGLocator);
+}
+
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  * Inserts
@@ -186,17 +219,11 @@ void RSCFC::insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel)
  * So only non-debug, non-use, non-jump and non-call instructions.
  */
 void RSCFC::countNrOfVerifiableInstruction(){
+	nrOfVerifiableInstructions.assign(n_basic_blocks_for_fn(cfun)-2, 0);
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) -2;
-		unsigned int nr = 0;
-		rtx_insn* insn;
-		FOR_BB_INSNS(bb, insn){
-			if((NONDEBUG_INSN_P(insn)) && (!InstrType::isUse(insn)) && (!JUMP_P(insn)) && (!CALL_P(insn)) ){ //&& (!UpdatePoint::isCompare(insn))
-				nr++;
-			}
-		}
-		nrOfVerifiableInstructions.push_back(nr);
+		nrOfVerifiableInstructions[idBB] = BlockSummary::nrOfVerifiableInstr(bb);
 	}
 }
 
@@ -223,7 +250,7 @@ rtx_insn* RSCFC::emitMVN(unsigned int regNr, rtx_insn* prev, basic_block bb){
 	rtx reg = gen_rtx_REG(SImode, regNr);
 	rtx notRtx = gen_rtx_NOT(SImode, reg);
 	rtx set = gen_rtx_SET(reg, notRtx);
-	return emit_insn_after_noloc(set , prev, bb);
+	return AsmGen::emitInsn(set , prev, bb, true);
 }
 
 /**
@@ -234,5 +261,5 @@ rtx_insn* RSCFC::emitAnd(rtx_insn* previous, basic_block bb){
 	rtx reg12 = gen_rtx_REG(SImode, regsToUse[1]);
 	rtx andRtx = gen_rtx_AND(SImode, reg11, reg12);
 	rtx set = gen_rtx_SET(reg11, andRtx);
-	return emit_insn_after_noloc(set, previous, bb);
+	return AsmGen::emitInsn(set, previous, bb, true);
 }
@@ -28,7 +28,11 @@ class RSCFC : public GeneralCFED{
 		~RSCFC(){}
 
 	private:
+		void initVariables();
+		unsigned int maxNrOfBB();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -12,6 +12,7 @@
 #include "AsmGen.h"
 #include "UpdatePoint.h"
 #include "InstrType.h"
+#include "PlanCache.h"
 
 /**
  * Constructor, initializes necessary variables
@@ -20,11 +21,21 @@ SCFC::SCFC(ARM_ISA* isa, unsigned int nrOfRegsToUse)
 	:GeneralCFED(isa, nrOfRegsToUse){
 }
 
+/**
+ * Function to tell the largest number of basic blocks SCFC can protect:
+ * each basic block is represented by one bit of the 32-bit signature register
+ */
+unsigned int SCFC::maxNrOfBB(){
+	return 32;
+}
+
 /**
  * Function to calculate / assign the
+ * 	- bit of the signature register of each basic block
  * 	- compile-time signatures for each basic block
  */
 void SCFC::calcVariables(){
+	assignSignatureBits(this->sigBits);
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int si = 0;
@@ -32,9 +43,9 @@ void SCFC::calcVariables(){
 		edge_iterator ei;
 		FOR_EACH_EDGE(e, ei, bb->succs){
 			if (e->src == bb){
-				unsigned int leftShift = (e->dest)->index - 2;
-				if(leftShift < (last_basic_block_for_fn(cfun))){
-					si |= 1 << leftShift;
+				unsigned int idSucc = (e->dest)->index - 2;
+				if(idSucc < sigBits.size()){
+					si |= 1 << sigBits[idSucc];
 				}
 			}
 		}
@@ -42,6 +53,20 @@ void SCFC::calcVariables(){
 	}
 }
 
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void SCFC::savePlan(vector<int>& plan){
+	PlanCache::appendValues(plan, this->sigBits);
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void SCFC::loadPlan(vector<int>& plan, unsigned int& pos){
+	PlanCache::readValues(plan, pos, this->sigBits);
+}
+
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  */
@@ -65,7 +90,7 @@ void SCFC::insertBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, r
  * Function to insert the necessary inter-block CFE detection instructions
  * in the middle of each basic block
  * Inserts:
- * 	AND r11, #<mask> -> mask = 1 << idBasicBlock
+ * 	AND r11, #<mask> -> mask = 1 << bitBasicBlock
  * 	CMP r11, #0
  * 	BEQ .codeLabel
  * 	MOV r11, #<compileTimeSignatureBasicBlock>
@@ -74,10 +99,10 @@ void SCFC::insertMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel,
 	//rtx_insn* prev = emitLSR(idBB, attachAfter, bb);
 	rtx_insn* prev = attachAfter;
 	if (this->nrOfOrigInstr[idBB] == 1){
-		prev = AsmGen::emitAndRegInt(regsToUse[0], (1<< idBB), prev, bb, false);
+		prev = AsmGen::emitAndRegInt(regsToUse[0], (1 << sigBits[idBB]), prev, bb, false);
 	}
 	else{
-		prev = AsmGen::emitAndRegInt(regsToUse[0], (1<< idBB), prev, bb, true);
+		prev = AsmGen::emitAndRegInt(regsToUse[0], (1 << sigBits[idBB]), prev, bb, true);
 	}
 	prev = AsmGen::emitCmpRegInt(regsToUse[0], 0, prev, bb, true);
 	prev = AsmGen::emitBeq(codeLabel, prev, bb, true);
@@ -126,6 +151,14 @@ void SCFC::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 	}
 }
 
+/**
+ * SCFC updates r10 conditionally (MOV<cond>)
+ * at the end of every basic block ending in a conditional branch
+ */
+bool SCFC::needsCondUpdate(unsigned int idBB, basic_block bb){
+	return true;
+}
+
 /**
  * Function to insert the necessary setup code at the beginning
  * of the first basic block
@@ -172,9 +205,9 @@ rtx_insn* SCFC::emitLSR(unsigned int idBB, rtx_insn* attachRtx, basic_block bb){
 	rtx regSig = gen_rtx_REG(SImode, regsToUse[0]);
 	rtx regID = gen_rtx_REG(SImode, regsToUse[1]);
 	if (this->nrOfOrigInstr[idBB] == 1){
-		return emit_insn_before_noloc(gen_rotrsi3(regSig, regSig, regID), attachRtx,bb);
+		return AsmGen::emitInsn(gen_rotrsi3(regSig, regSig, regID), attachRtx, bb, false);
 	}
 	else{
-		return emit_insn_after_noloc(gen_rotrsi3(regSig, regSig, regID), attachRtx,bb);
+		return AsmGen::emitInsn(gen_rotrsi3(regSig, regSig, regID), attachRtx, bb, true);
 	}
 }
@@ -27,7 +27,10 @@ class SCFC : public GeneralCFED{
 		~SCFC(){}
 
 	private:
+		unsigned int maxNrOfBB();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -36,12 +39,16 @@ class SCFC : public GeneralCFED{
 		void insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 		void insertSetup();
 
+		bool needsCondUpdate(unsigned int idBB, basic_block bb);
+
 		// Selective methods
 		void insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore);
 		void insertSelMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
 		void insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
 		rtx_insn* emitLSR(unsigned int idBB, rtx_insn* attachRtx, basic_block bb);
+
+		vector<unsigned int> sigBits;		// Bit of the signature register per basic block
 };
 
 #endif /* CFED_TECHNIQUES_SCFC_H_ */
@@ -12,6 +12,7 @@
 #include "AsmGen.h"
 #include "UpdatePoint.h"
 #include "InstrType.h"
+#include "PlanCache.h"
 
 /**
  * Constructor, initializes necessary variables
@@ -20,11 +21,21 @@ SEDSR::SEDSR(ARM_ISA* isa, unsigned int nrOfRegsToUse)
 	:GeneralCFED(isa, nrOfRegsToUse){
 }
 
+/**
+ * Function to tell the largest number of basic blocks SEDSR can protect:
+ * each basic block is represented by one bit of the 32-bit signature register
+ */
+unsigned int SEDSR::maxNrOfBB(){
+	return 32;
+}
+
 /**
  * Function to calculate / assign the
+ * 	- bit of the signature register of each basic block
  * 	- compile-time signatures for each basic block
  */
 void SEDSR::calcVariables(){
+	assignSignatureBits(this->sigBits);
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int si = 0;
@@ -32,9 +43,9 @@ void SEDSR::calcVariables(){
 		edge_iterator ei;
 		FOR_EACH_EDGE(e, ei, bb->succs){
 			if (e->src == bb){
-				unsigned int leftShift = (e->dest)->index - 2;
-				if(leftShift < (last_basic_block_for_fn(cfun))){
-					si |= 1 << leftShift;
+				unsigned int idSucc = (e->dest)->index - 2;
+				if(idSucc < sigBits.size()){
+					si |= 1 << sigBits[idSucc];
 				}
 			}
 		}
@@ -42,6 +53,20 @@ void SEDSR::calcVariables(){
 	}
 }
 
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void SEDSR::savePlan(vector<int>& plan){
+	PlanCache::appendValues(plan, this->sigBits);
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void SEDSR::loadPlan(vector<int>& plan, unsigned int& pos){
+	PlanCache::readValues(plan, pos, this->sigBits);
+}
+
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  */
@@ -53,13 +78,13 @@ void SEDSR::insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx
  * Function to insert the necessary inter-block CFE detection instructions
  * at the beginning of each basic block
  * Inserts:
- * 	AND r11, #<mask> -> mask = 1 << idBasicBlock
+ * 	AND r11, #<mask> -> mask = 1 << bitBasicBlock
  * 	CMP r11, #0
  * 	BEQ .codeLabel
  */
 void SEDSR::insertBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore){
 	//rtx_insn* prev = emitLSR(idBB, attachBefore, bb);
-	rtx_insn* prev = AsmGen::emitAndRegInt(regsToUse[0], (1<<idBB), attachBefore, bb, false);
+	rtx_insn* prev = AsmGen::emitAndRegInt(regsToUse[0], (1 << sigBits[idBB]), attachBefore, bb, false);
 	prev = AsmGen::emitCmpRegInt(regsToUse[0], 0, prev, bb, true);
 	AsmGen::emitBeq(codeLabel, prev, bb, true);
 }
@@ -89,6 +114,14 @@ void SEDSR::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 	// Nothing to do for SEDSR
 }
 
+/**
+ * SEDSR handles table jumps without changes: the signature
+ * of a basic block has a bit for each of its successors
+ */
+bool SEDSR::supportsTableJumps(){
+	return true;
+}
+
 /**
  * Function to insert the necessary setup code at the beginning
  * of the first basic block
@@ -132,5 +165,5 @@ void SEDSR::insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel)
 rtx_insn* SEDSR::emitLSR(unsigned int idBB, rtx_insn* next, basic_block bb){
 	rtx regSig = gen_rtx_REG(SImode, regsToUse[0]);
 	rtx constInt = gen_rtx_CONST_INT(VOIDmode, idBB);
-	return emit_insn_before_noloc(gen_rotrsi3(regSig, regSig, constInt), next,bb);
+	return AsmGen::emitInsn(gen_rotrsi3(regSig, regSig, constInt), next, bb, false);
 }
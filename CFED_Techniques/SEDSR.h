@@ -27,7 +27,10 @@ class SEDSR : public GeneralCFED{
 		~SEDSR(){}
 
 	private:
+		unsigned int maxNrOfBB();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -35,6 +38,7 @@ class SEDSR : public GeneralCFED{
 		void insertMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
 		void insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 		void insertSetup();
+		bool supportsTableJumps();
 
 		// Selective methods
 		void insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore);
@@ -42,6 +46,8 @@ class SEDSR : public GeneralCFED{
 		void insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
 		rtx_insn* emitLSR(unsigned int idBB, rtx_insn* next, basic_block bb);
+
+		vector<unsigned int> sigBits;		// Bit of the signature register per basic block
 };
 
 
@@ -9,7 +9,9 @@
 #include <rtl.h>
 
 #include "SIED.h"
+#include "PlanCache.h"
 #include "AsmGen.h"
+#include "BlockSummary.h"
 #include "UpdatePoint.h"
 #include "InstrType.h"
 
@@ -22,6 +24,13 @@ SIED::SIED(ARM_ISA* isa, unsigned int nrOfRegsToUse, bool intraDet)
 	this->intraDet = intraDet;
 }
 
+/**
+ * Function to reset the per-function variables
+ */
+void SIED::initVariables(){
+	branchSigs.clear();
+}
+
 /**
  * Function to calculate / assign the
  * 	- compile-time signatures for each basic block
@@ -41,6 +50,30 @@ void SIED::calcVariables(){
 		calcYvalues(idBB, bb);
 	}
 }
+
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void SIED::savePlan(vector<int>& plan){
+	PlanCache::appendValues(plan, this->nrOfVerifiableInstructions);
+	plan.push_back(branchSigs.size());
+	for(unsigned int i = 0; i < branchSigs.size(); i++){
+		plan.push_back(branchSigs[i].trueBranch);
+		plan.push_back(branchSigs[i].falseBranch);
+	}
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void SIED::loadPlan(vector<int>& plan, unsigned int& pos){
+	PlanCache::readValues(plan, pos, this->nrOfVerifiableInstructions);
+	branchSigs.resize(PlanCache::readValue(plan, pos));
+	for(unsigned int i = 0; i < branchSigs.size(); i++){
+		branchSigs[i].trueBranch = PlanCache::readValue(plan, pos);
+		branchSigs[i].falseBranch = PlanCache::readValue(plan, pos);
+	}
+}
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  * Inserts:
@@ -140,6 +173,14 @@ void SIED::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 	}
 }
 
+/**
+ * SIED updates r10 and r9 conditionally (MOV<cond>)
+ * at the end of every basic block ending in a conditional branch
+ */
+bool SIED::needsCondUpdate(unsigned int idBB, basic_block bb){
+	return true;
+}
+
 /**
  * Function to insert the necessary setup code at the beginning
  * of the first basic block
@@ -203,17 +244,11 @@ void SIED::insertSelEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
  * So only non-debug, non-use, non-jump and non-call instructions.
  */
 void SIED::countNrOfVerifiableInstruction(){
+	nrOfVerifiableInstructions.assign(n_basic_blocks_for_fn(cfun)-2, 0);
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
 		unsigned int idBB = (bb->index) -2;
-		unsigned int nr = 0;
-		rtx_insn* insn;
-		FOR_BB_INSNS(bb, insn){
-			if((NONDEBUG_INSN_P(insn)) && (!InstrType::isUse(insn)) && (!JUMP_P(insn)) && (!CALL_P(insn)) ){ //&& (!UpdatePoint::isCompare(insn))
-				nr++;
-			}
-		}
-		nrOfVerifiableInstructions.push_back(nr);
+		nrOfVerifiableInstructions[idBB] = BlockSummary::nrOfVerifiableInstr(bb);
 	}
 }
 
@@ -272,5 +307,5 @@ rtx_insn* SIED::insertCMP(rtx_insn* previous, basic_block bb){
 	rtx cmp = gen_rtx_COMPARE(CCmode, sigReg, branchReg);
 	rtx regCC = gen_rtx_REG(CCmode, CC_REGNUM);
 	rtx set = gen_rtx_SET(regCC, cmp);
-	return emit_insn_after_noloc(set, previous, bb);
+	return AsmGen::emitInsn(set, previous, bb, true);
 }
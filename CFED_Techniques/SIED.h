@@ -28,7 +28,10 @@ class SIED : public GeneralCFED{
 		~SIED(){}
 
 	private:
+		void initVariables();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -37,6 +40,8 @@ class SIED : public GeneralCFED{
 		void insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 		void insertSetup();
 
+		bool needsCondUpdate(unsigned int idBB, basic_block bb);
+
 		// Selective methods
 		void insertSelBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore);
 		void insertSelMiddle(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachAfter);
@@ -9,6 +9,7 @@
 #include <rtl.h>
 
 #include "YACCA.h"
+#include "PlanCache.h"
 #include "primeNumbers.h"
 #include "AsmGen.h"
 #include "UpdatePoint.h"
@@ -19,10 +20,24 @@
  */
 YACCA::YACCA(ARM_ISA* isa, unsigned int nrOfRegsToUse)
 	:GeneralCFED(isa, nrOfRegsToUse){
+}
+
+/**
+ * Function to reset the per-function variables
+ */
+void YACCA::initVariables(){
 	// previousValues has to be filled with '1'
-	for (int i = 0; i < n_basic_blocks_for_fn(cfun)-2; i++){
-		previousValues.push_back(1);
-	}
+	previousValues.assign(n_basic_blocks_for_fn(cfun)-2, 1);
+	M1Values.clear();
+	M2Values.clear();
+}
+
+/**
+ * Function to tell the largest number of basic blocks YACCA can protect:
+ * each basic block needs its own prime number as signature
+ */
+unsigned int YACCA::maxNrOfBB(){
+	return primeNumber.size();
 }
 
 /**
@@ -48,6 +63,24 @@ void YACCA::calcVariables(){
 	M2Values[0] = 4;
 }
 
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void YACCA::savePlan(vector<int>& plan){
+	PlanCache::appendValues(plan, this->previousValues);
+	PlanCache::appendValues(plan, this->M1Values);
+	PlanCache::appendValues(plan, this->M2Values);
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void YACCA::loadPlan(vector<int>& plan, unsigned int& pos){
+	PlanCache::readValues(plan, pos, this->previousValues);
+	PlanCache::readValues(plan, pos, this->M1Values);
+	PlanCache::readValues(plan, pos, this->M2Values);
+}
+
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  */
@@ -59,12 +92,22 @@ void YACCA::insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx
  * Function to insert the necessary inter-block CFE detection instructions
  * at the beginning of each basic block
  * Inserts:
- * 	MOV r10, #<previousValueBasicBlock>
+ * 	MOV r10, #<previousValueBasicBlock> -> not on ARMv6-M, the test does not use it there
  * 	generateTest instructions
  */
 void YACCA::insertBegin(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachBefore){
-	rtx_insn* prev = AsmGen::emitMovRegInt(regsToUse[1], previousValues[idBB], attachBefore, bb, false);
-	generateTest(idBB, bb, codeLabel, prev);
+	switch(ARM_ISA::getISAtarget(arm_cpu_option)){
+		case ARMv7M:
+			{
+			rtx_insn* prev = AsmGen::emitMovRegInt(regsToUse[1], previousValues[idBB], attachBefore, bb, false);
+			generateTest(idBB, bb, codeLabel, prev, true);
+			break;
+			}
+		case ARMv6M:
+		default:
+			generateTest(idBB, bb, codeLabel, attachBefore, false);
+			break;
+	}
 }
 
 /**
@@ -88,7 +131,7 @@ void YACCA::insertEnd(unsigned int idBB, basic_block bb, rtx_insn* codeLabel){
 	if( !(InstrType::isExitBlock(bb) && nrOfOrigInstr[idBB] == 1 ) ) {
 		rtx_insn* prev = UpdatePoint::lastRealSafeINSN(bb);
 		if(insertTestEnd(prev)){
-			prev = generateTest(idBB, bb, codeLabel, prev);
+			prev = generateTest(idBB, bb, codeLabel, prev, true);
 		}
 		if(M1Values[idBB] != -1){
 			prev = AsmGen::emitAndRegInt(regsToUse[0], M1Values[idBB], prev, bb, true);
@@ -205,18 +248,125 @@ unsigned int YACCA::calcXORmask(unsigned int m1){
 }
 
 /**
- * Function to emit the Test instructions
+ * Function to emit the Test instructions, which check that the run-time code (r11)
+ * is the signature of a predecessor, i.e. divides the PREVIOUS value (r10)
  * Inserts:
  * 	UDIV r9, r10, r11
  * 	MUL r9, r11
  * 	CMP r9, r10
  * 	BNE .codeLabel
+ *
+ * or, on ARMv6-M which has no divider
+ * 	MOV r9, r11
+ * 	SUB r9, #<signatureFirstPredecessor>
+ * 	MOV r10, r11
+ * 	SUB r10, #<signaturePredecessor>
+ * 	MUL r9, r9, r10 -> these 3 above instructions for each other predecessor
+ * 	CMP r9, #0
+ * 	BNE .codeLabel
+ * The product is 0 if the code equals the signature of one of the predecessors.
+ * The product is computed modulo 2^32 and every factor is even, so it can also wrap
+ * to 0 (see productMayWrap). In that case a compare chain is inserted instead:
+ * 	MOV r10, #<signaturePredecessor>
+ * 	CMP r11, r10
+ * 	BEQ .accepted -> these 3 above instructions for each predecessor but the last
+ * 	MOV r10, #<signatureLastPredecessor>
+ * 	CMP r11, r10
+ * 	BNE .codeLabel
+ * 	.accepted:
+ * Nothing is inserted if the PREVIOUS value is 0, the UDIV form accepts every code then.
  */
-rtx_insn* YACCA::generateTest(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachRTX){
-	rtx_insn* prev = AsmGen::emitUdivRegRegReg(regsToUse[2], regsToUse[1], regsToUse[0], attachRTX, bb, true);
-	prev = AsmGen::emitMulRegReg(regsToUse[2], regsToUse[2], regsToUse[0], prev, bb, true);
-	prev = AsmGen::emitCmpRegReg(regsToUse[2], regsToUse[1], prev, bb, true);
-	return AsmGen::emitBne(codeLabel, prev, bb, true);
+rtx_insn* YACCA::generateTest(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachRTX, bool after){
+	if(ARM_ISA::getISAtarget(arm_cpu_option) == ARMv7M){
+		AsmGen::startSequence();
+		AsmGen::emitUdivRegRegReg(regsToUse[2], regsToUse[1], regsToUse[0], NULL, bb, true);
+		AsmGen::emitMulRegReg(regsToUse[2], regsToUse[2], regsToUse[0], NULL, bb, true);
+		AsmGen::emitCmpRegReg(regsToUse[2], regsToUse[1], NULL, bb, true);
+		AsmGen::emitBne(codeLabel, NULL, bb, true);
+		return AsmGen::endSequence(attachRTX, bb, after);
+	}
+
+	if(previousValues[idBB] == 0){
+		return attachRTX;
+	}
+	// The accepted codes, a PREVIOUS value of 1 (no predecessors) only accepts 1
+	vector<unsigned int> predSignatures;
+	edge e;
+	edge_iterator ei;
+	FOR_EACH_EDGE(e, ei, bb->preds){
+		unsigned int idOrig = (e->src)->index - 2;
+		if(idOrig < n_basic_blocks_for_fn(cfun)-2){
+			predSignatures.push_back(signatures[idOrig]);
+		}
+	}
+	if(predSignatures.empty()){
+		predSignatures.push_back(1);
+	}
+
+	if(productMayWrap(predSignatures)){
+		rtx_insn* prev = attachRTX;
+		bool afterPrev = after;
+		rtx_insn* accepted = 0x00;
+		if(predSignatures.size() > 1){
+			accepted = AsmGen::emitCodeLabel(0, attachRTX, bb, after);
+			prev = accepted;
+			afterPrev = false;
+		}
+		for(unsigned int i = 0; i < predSignatures.size(); i++){
+			prev = AsmGen::emitMovRegInt(regsToUse[1], predSignatures[i], prev, bb, afterPrev);
+			prev = AsmGen::emitCmpRegReg(regsToUse[0], regsToUse[1], prev, bb, true);
+			if(i + 1 < predSignatures.size()){
+				prev = AsmGen::emitCondJump(EQ, accepted, prev, bb, true);
+			}
+			else{
+				prev = AsmGen::emitBne(codeLabel, prev, bb, true);
+			}
+			afterPrev = true;
+		}
+		return (accepted != 0x00) ? accepted : prev;
+	}
+
+	AsmGen::startSequence();
+	AsmGen::emitMovRegReg(regsToUse[2], regsToUse[0], NULL, bb, true);
+	AsmGen::emitSubRegInt(regsToUse[2], predSignatures[0], NULL, bb, true);
+	for(unsigned int i = 1; i < predSignatures.size(); i++){
+		AsmGen::emitMovRegReg(regsToUse[1], regsToUse[0], NULL, bb, true);
+		AsmGen::emitSubRegInt(regsToUse[1], predSignatures[i], NULL, bb, true);
+		AsmGen::emitMulRegReg(regsToUse[2], regsToUse[2], regsToUse[1], NULL, bb, true);
+	}
+	AsmGen::emitCmpRegInt(regsToUse[2], 0, NULL, bb, true);
+	AsmGen::emitBne(codeLabel, NULL, bb, true);
+	return AsmGen::endSequence(attachRTX, bb, after);
+}
+
+/**
+ * Function to determine whether the product of (code - s_pred) over the predecessor
+ * signatures can wrap to 0 modulo 2^32 for a code that is not one of them.
+ * Every factor is even, so this happens for any code from 32 predecessors on.
+ * Below that, the codes a CFE between the basic blocks of the function produces,
+ * i.e. their signatures, are checked: the powers of two of their factors must
+ * add up to less than 32. Other codes, such as a corrupted signature register,
+ * can still wrap the product in rare cases.
+ */
+bool YACCA::productMayWrap(vector<unsigned int>& predSignatures){
+	if(predSignatures.size() >= 32){
+		return true;
+	}
+	for(unsigned int c = 0; c <= signatures.size(); c++){
+		unsigned int code = (c < signatures.size()) ? signatures[c] : 1;
+		unsigned int twos = 0;
+		for(unsigned int i = 0; i < predSignatures.size(); i++){
+			if(code == predSignatures[i]){
+				twos = 0;
+				break;
+			}
+			twos += __builtin_ctz(code - predSignatures[i]);
+		}
+		if(twos >= 32){
+			return true;
+		}
+	}
+	return false;
 }
 
 /**
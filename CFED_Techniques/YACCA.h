@@ -27,7 +27,11 @@ class YACCA : public GeneralCFED{
 		~YACCA(){}
 
 	private:
+		void initVariables();
+		unsigned int maxNrOfBB();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
@@ -46,8 +50,9 @@ class YACCA : public GeneralCFED{
 		void calcM2(unsigned int idBB, basic_block bb);
 		unsigned int calcXORmask(unsigned int m1);
 
-		rtx_insn* generateTest(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachRTX);
+		rtx_insn* generateTest(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachRTX, bool after);
 		bool insertTestEnd(rtx_insn* testInsn);
+		bool productMayWrap(vector<unsigned int>& predSignatures);
 
 		vector<unsigned int> previousValues;
 		vector<signed int> M1Values;
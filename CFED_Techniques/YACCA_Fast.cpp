@@ -9,6 +9,7 @@
 #include <rtl.h>
 
 #include "YACCA_Fast.h"
+#include "PlanCache.h"
 #include "primeNumbers.h"
 #include "AsmGen.h"
 #include "UpdatePoint.h"
@@ -21,6 +22,23 @@ YACCA_Fast::YACCA_Fast(ARM_ISA* isa, unsigned int nrOfRegsToUse)
 	: GeneralCFED(isa, nrOfRegsToUse){
 }
 
+/**
+ * Function to reset the per-function variables
+ */
+void YACCA_Fast::initVariables(){
+	previousValues.clear();
+	M1Values.clear();
+	M2Values.clear();
+}
+
+/**
+ * Function to tell the largest number of basic blocks YACCA_Fast can protect:
+ * each basic block needs its own prime number as signature
+ */
+unsigned int YACCA_Fast::maxNrOfBB(){
+	return primeNumber.size();
+}
+
 /**
  * Function to calculate / assign the
  * 	- compile-time signatures for each basic block
@@ -44,6 +62,30 @@ void YACCA_Fast::calcVariables(){
 	M2Values[0] = 4;
 }
 
+/**
+ * Function to append the variables computed by calcVariables to the plan
+ */
+void YACCA_Fast::savePlan(vector<int>& plan){
+	plan.push_back(previousValues.size());
+	for(unsigned int i = 0; i < previousValues.size(); i++){
+		PlanCache::appendValues(plan, this->previousValues[i]);
+	}
+	PlanCache::appendValues(plan, this->M1Values);
+	PlanCache::appendValues(plan, this->M2Values);
+}
+
+/**
+ * Function to restore the variables computed by calcVariables from the plan
+ */
+void YACCA_Fast::loadPlan(vector<int>& plan, unsigned int& pos){
+	previousValues.resize(PlanCache::readValue(plan, pos));
+	for(unsigned int i = 0; i < previousValues.size(); i++){
+		PlanCache::readValues(plan, pos, this->previousValues[i]);
+	}
+	PlanCache::readValues(plan, pos, this->M1Values);
+	PlanCache::readValues(plan, pos, this->M2Values);
+}
+
 /**
  * Function to insert the necessary intra-block CFE detection instructions
  */
@@ -228,28 +270,27 @@ unsigned int YACCA_Fast::calcXORmask(unsigned int m1){
  * 	SUB r9, #<( numberOfPredecessors - 1 )>
  */
 rtx_insn* YACCA_Fast::generateTest(unsigned int idBB, basic_block bb, rtx_insn* codeLabel, rtx_insn* attachRTX, bool after){
-	rtx_insn* prev = attachRTX;
-	vector<unsigned int > predecessors = previousValues[idBB];
+	vector<unsigned int>& predecessors = previousValues[idBB];
+	AsmGen::startSequence();
 	if(predecessors.size() == 1){
-		prev = AsmGen::emitMovRegInt(regsToUse[1], predecessors[0], prev, bb, after);
-		prev = AsmGen::emitCmpRegReg(regsToUse[0], regsToUse[1], prev, bb, true);
-		prev = AsmGen::emitBne(codeLabel, prev, bb, true);
+		AsmGen::emitMovRegInt(regsToUse[1], predecessors[0], NULL, bb, true);
+		AsmGen::emitCmpRegReg(regsToUse[0], regsToUse[1], NULL, bb, true);
+		AsmGen::emitBne(codeLabel, NULL, bb, true);
 	}
 	else{
 		vector<unsigned int>::const_iterator it;
 		for(it = predecessors.begin(); it != predecessors.end(); it++){
-			prev = AsmGen::emitMovRegInt(regsToUse[1], *it, prev, bb, after);
-			after = true;
-			prev = AsmGen::emitCmpRegReg(regsToUse[0], regsToUse[1], prev, bb, true);
-			prev = AsmGen::emitCondAddRegInt(regsToUse[2], 1, NE, prev, bb, true);
+			AsmGen::emitMovRegInt(regsToUse[1], *it, NULL, bb, true);
+			AsmGen::emitCmpRegReg(regsToUse[0], regsToUse[1], NULL, bb, true);
+			AsmGen::emitCondAddRegInt(regsToUse[2], 1, NE, NULL, bb, true);
 		}
-		prev = AsmGen::emitCmpRegInt(regsToUse[2], (previousValues[idBB]).size()-1, prev, bb, true);
-		//prev = AsmGen::emitBhs(codeLabel, prev, bb, true);
-		//prev = AsmGen::emitCmpRegInt(regsToUse[2], 1, prev, bb, true);
-		prev = AsmGen::emitBne(codeLabel, prev, bb, true);
-		prev =  AsmGen::emitSubRegInt(regsToUse[2], (previousValues[idBB]).size()-1, prev, bb, true); // clear error flag
+		AsmGen::emitCmpRegInt(regsToUse[2], (previousValues[idBB]).size()-1, NULL, bb, true);
+		//AsmGen::emitBhs(codeLabel, NULL, bb, true);
+		//AsmGen::emitCmpRegInt(regsToUse[2], 1, NULL, bb, true);
+		AsmGen::emitBne(codeLabel, NULL, bb, true);
+		AsmGen::emitSubRegInt(regsToUse[2], (previousValues[idBB]).size()-1, NULL, bb, true); // clear error flag
 	}
-	return prev;
+	return AsmGen::endSequence(attachRTX, bb, after);
 }
 
 /**
@@ -27,7 +27,11 @@ class YACCA_Fast : public GeneralCFED{
 		~YACCA_Fast(){}
 
 	private:
+		void initVariables();
+		unsigned int maxNrOfBB();
 		void calcVariables();
+		void savePlan(vector<int>& plan);
+		void loadPlan(vector<int>& plan, unsigned int& pos);
 
 		void insertIntraBlockJumpDetection(unsigned int idBB, basic_block bb, rtx_insn* codeLabel);
 
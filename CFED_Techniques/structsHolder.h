@@ -40,4 +40,73 @@ struct SIEDbranch{
 	unsigned int falseBranch;
 };
 
+/**
+ * Struct used to save a candidate zero-adjust edge of RACFED
+ * Contains:
+ * 	- Id of the source basic block
+ * 	- Id of the destination basic block
+ * 	- The estimated execution frequency of the edge
+ */
+struct RACFEDedge{
+	unsigned int srcBBId;
+	unsigned int destBBId;
+	double weight;
+};
+
+/**
+ * Struct holding the plugin arguments with which a technique is implemented
+ * Contains:
+ * 	- Whether or not intra-block CFE detection instructions are inserted
+ * 	- The selective level (0 = full, 1 = selective, 2 = profile-guided, 3 = loop-aware)
+ * 	- The threshold above which a basic block is hot (selective level 2):
+ * 	  an execution count, or a percentile of the block counts written as p<percentile>
+ * 	- Every how many iterations the loop latches are checked (selective level 3),
+ * 	  0 to only check at the loop exits
+ * 	- The constraints for techniqueSpecific=auto (0 = no constraint): the minimal percentage
+ * 	  of checked basic blocks, the maximal detection latency in instructions and the maximal
+ * 	  code size increase in percent
+ * 	- Whether or not the inserted instructions are folded by the peephole optimizer
+ * 	- Whether or not the signatures are assigned to minimize the emitted adjust instructions
+ * 	- Whether the registers of the technique are chosen per function among the unused ones,
+ * 	  instead of the fixed ones that must be reserved for the whole program
+ * 	- Whether or not the inserted instructions are rescheduled among the original instructions
+ * 	- Whether the registers and immediates are picked to maximize 16-bit Thumb encodings
+ * 	- The registers of the technique provided as plugin argument, NULL for the default ones
+ * 	- Whether a failed check raises a trap (UDF) instead of branching to the error handler
+ * 	- Whether extra error stubs are placed so every check reaches one with a 16-bit branch
+ */
+struct CFEDoptions{
+	bool intraBlockDet;
+	unsigned int selectiveLevel;
+	const char* profileThreshold;
+	unsigned int loopCheckInterval;
+	unsigned int autoCoverage;
+	unsigned int autoLatency;
+	unsigned int autoSizeBudget;
+	bool peephole;
+	bool optimizeSignatures;
+	bool freeRegisters;
+	bool reschedule;
+	bool compactEncoding;
+	const char* registers;
+	bool trapDetection;
+	bool nearErrorStubs;
+};
+
+/**
+ * Struct holding the estimated cost of a technique for one function
+ * Contains:
+ * 	- The number of inserted instructions and the number of original instructions
+ * 	- The estimated number of inserted instructions executed per call
+ * 	- The worst-case detection latency in instructions
+ * 	- The percentage of basic blocks that contain a check
+ */
+struct CFEDcost{
+	unsigned int insertedInsns;
+	unsigned int origInsns;
+	double executedInsns;
+	unsigned int latency;
+	unsigned int coverage;
+};
+
 #endif /* CFED_TECHNIQUES_STRUCTSHOLDER_H_ */
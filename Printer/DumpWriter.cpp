@@ -0,0 +1,82 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "DumpWriter.h"
+
+deque<DumpJob> DumpWriter::queue;
+mutex DumpWriter::queueMutex;
+condition_variable DumpWriter::queueChanged;
+thread DumpWriter::writer;
+bool DumpWriter::stopping = false;
+
+/**
+ * Function to hand a formatted dump to the writer thread.
+ * Takes ownership of data. Starts the writer thread on first use.
+ * Only waits when queueLimit dumps are still waiting to be written.
+ */
+void DumpWriter::enqueue(const char* path, char* data, size_t size){
+	unique_lock<mutex> lock(queueMutex);
+	if(!writer.joinable()){
+		// cc1 can exit without PLUGIN_FINISH (e.g. fatal_error), a joinable thread would then abort
+		static bool exitHook = (atexit(finish) == 0);
+		(void) exitHook;
+		stopping = false;
+		writer = thread(writeJobs);
+	}
+	queueChanged.wait(lock, []{ return queue.size() < queueLimit; });
+	DumpJob job = {path, data, size};
+	queue.push_back(job);
+	queueChanged.notify_all();
+}
+
+/**
+ * Function to write all remaining dumps and stop the writer thread.
+ * Called at PLUGIN_FINISH and at exit, and before a dump directory is renamed.
+ * The next enqueue starts the writer thread again.
+ */
+void DumpWriter::finish(){
+	{
+		lock_guard<mutex> lock(queueMutex);
+		if(!writer.joinable()){
+			return;
+		}
+		stopping = true;
+	}
+	queueChanged.notify_all();
+	writer.join();
+}
+
+// -------------------------------------- Private Section ------------------------------
+
+/**
+ * Body of the writer thread: writes the queued dumps in order
+ * until finish is called and the queue is empty
+ */
+void DumpWriter::writeJobs(){
+	while(true){
+		DumpJob job;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			queueChanged.wait(lock, []{ return stopping || !queue.empty(); });
+			if(queue.empty()){
+				return;
+			}
+			job = queue.front();
+			queue.pop_front();
+		}
+		queueChanged.notify_all();
+
+		FILE* fp = fopen(job.path.c_str(), "w");
+		if(fp != NULL){
+			fwrite(job.data, 1, job.size, fp);
+			fclose(fp);
+		}
+		free(job.data);
+	}
+}
@@ -0,0 +1,59 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * Header file of the DumpWriter class.
+ *
+ * It contains the prototypes of the methods used to hand formatted
+ * dump buffers to a background thread, which writes them to disk.
+ * This way the pass itself does not wait for file I/O.
+ */
+
+#ifndef PRINTER_DUMPWRITER_H_
+#define PRINTER_DUMPWRITER_H_
+
+#include <stddef.h>
+
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * Struct holding one formatted dump
+ * Contains:
+ * 	- The path of the file to write to
+ * 	- The formatted data (malloc'ed, freed by the writer)
+ * 	- The size of the formatted data
+ */
+struct DumpJob{
+	string path;
+	char* data;
+	size_t size;
+};
+
+class DumpWriter{
+	public:
+		static void enqueue(const char* path, char* data, size_t size);
+		static void finish();
+
+	private:
+		static const size_t queueLimit = 64;
+
+		static deque<DumpJob> queue;
+		static mutex queueMutex;
+		static condition_variable queueChanged;
+		static thread writer;
+		static bool stopping;
+
+		static void writeJobs();
+};
+
+
+#endif /* PRINTER_DUMPWRITER_H_ */
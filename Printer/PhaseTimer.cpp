@@ -0,0 +1,40 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include <gcc-plugin.h>
+#include <timevar.h>
+#include <statistics.h>
+#include <function.h>
+
+#include "PhaseTimer.h"
+
+/**
+ * Constructor, starts timing the phase if -ftime-report is active
+ * @param phase Name of the phase, must be a string literal
+ */
+PhaseTimer::PhaseTimer(const char* phase){
+	started = (g_timer != NULL);
+	if(started){
+		g_timer->push_client_item(phase);
+	}
+}
+
+/**
+ * Destructor, stops timing the phase
+ */
+PhaseTimer::~PhaseTimer(){
+	if(started){
+		g_timer->pop_client_item();
+	}
+}
+
+/**
+ * Function to increment a statistics counter of the current function
+ * Only has an effect if -fdump-statistics is active
+ */
+void PhaseTimer::count(const char* counter, int increment){
+	statistics_counter_event(cfun, counter, increment);
+}
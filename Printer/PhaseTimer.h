@@ -0,0 +1,52 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * Header file of the PhaseTimer class.
+ *
+ * A PhaseTimer accounts the time spent in its scope to the given phase of
+ * the plugin in -ftime-report (listed as client items of the plugin pass).
+ * Using the scope makes sure the timer is also stopped when a technique throws.
+ *
+ * Also contains the names of the statistics counters of the plugin,
+ * reported through -fdump-statistics.
+ */
+
+#ifndef PRINTER_PHASETIMER_H_
+#define PRINTER_PHASETIMER_H_
+
+#include <gcc-plugin.h>
+
+// Statistics counters
+#define STAT_INSERTED_INSNS "CFED inserted insns"
+#define STAT_CHECKS "CFED checks"
+#define STAT_CBZ_SPLIT "CFED CBZ/CBNZ split"
+#define STAT_BLOCKS_SKIPPED "CFED blocks skipped"
+#define STAT_DYNAMIC_CHECKS_SAVED "CFED estimated executed checks saved"
+#define STAT_LOOP_CHECKS_HOISTED "CFED loop checks hoisted"
+#define STAT_PEEPHOLE_REMOVED "CFED peephole removed insns"
+#define STAT_MERGE_BLOCKS_WITH_D "CFED merge blocks needing D"
+#define STAT_SCHEDULER_MOVED "CFED scheduler moved insns"
+#define STAT_SCHEDULER_CYCLES_SAVED "CFED scheduler estimated cycles saved"
+#define STAT_INSERTED_16BIT "CFED inserted 16-bit insns"
+#define STAT_INSERTED_32BIT "CFED inserted 32-bit insns"
+#define STAT_LITERALS_AVOIDED "CFED literal loads avoided"
+#define STAT_ERROR_STUBS "CFED error stubs"
+#define STAT_FAR_CHECKS "CFED checks out of 16-bit branch range"
+
+class PhaseTimer{
+	public:
+		PhaseTimer(const char* phase);
+		~PhaseTimer();
+
+		static void count(const char* counter, int increment);
+
+	private:
+		bool started;
+};
+
+
+#endif /* PRINTER_PHASETIMER_H_ */
@@ -10,9 +10,12 @@
 #include <tree.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "Printer.h"
+#include "DumpWriter.h"
 
+DumpLevel Printer::dumpLevel = DUMP_RTL;
 
 /**
  * Function that writes the RTL statements to
@@ -20,10 +23,9 @@
  * @param fileName The name of the file to write to
  */
 void Printer::printRTL(char* fileName){
-	char tempName[512];
-	createFileName(tempName, fileName);
-	FILE *fp = fopen(tempName, "w");
-	if (fp != NULL){
+	DumpBuffer dump;
+	if (openDump(dump)){
+		FILE* fp = dump.fp;
 		basic_block bb;
 		FOR_ALL_BB_FN(bb, cfun){					// Loop over all Basic Blocks in the function, cfun = current function
 			fprintf(fp,"BB: %d\n", bb->index-2);
@@ -37,7 +39,39 @@ void Printer::printRTL(char* fileName){
 			}
 			fprintf(fp,"\n----------------------------------------------------------------\n\n");
 		}
-		fclose(fp);
+		closeDump(dump, fileName);
+	}
+}
+
+/**
+ * Function that writes only the RTL statements inserted by the plugin,
+ * i.e. the ones with an UID of at least firstNewUID, to
+ * the file with the given fileName
+ * @param fileName The name of the file to write to
+ * @param firstNewUID The value of get_max_uid() before the technique was implemented
+ */
+void Printer::printDelta(char* fileName, int firstNewUID){
+	DumpBuffer dump;
+	if (openDump(dump)){
+		FILE* fp = dump.fp;
+		basic_block bb;
+		FOR_ALL_BB_FN(bb, cfun){
+			bool header = false;
+			rtx_insn* insn;
+			FOR_BB_INSNS(bb, insn){
+				if( NONDEBUG_INSN_P(insn) && (INSN_UID(insn) >= firstNewUID) ){
+					if(!header){
+						fprintf(fp,"BB: %d\n", bb->index-2);
+						header = true;
+					}
+					print_rtl_single(fp, insn);
+				}
+			}
+			if(header){
+				fprintf(fp,"\n----------------------------------------------------------------\n\n");
+			}
+		}
+		closeDump(dump, fileName);
 	}
 }
 
@@ -46,10 +80,9 @@ void Printer::printRTL(char* fileName){
  * in various tools to validate the CFG build in those tools
  */
 void Printer::printEdges(char* fileName){
-	char tempName[512];
-	createFileName(tempName, fileName);
-	FILE *fp = fopen(tempName, "w");
-	if (fp != NULL){
+	DumpBuffer dump;
+	if (openDump(dump)){
+		FILE* fp = dump.fp;
 		basic_block bb;
 		FOR_EACH_BB_FN(bb, cfun){
 			unsigned int idBB = bb->index-2;
@@ -79,7 +112,7 @@ void Printer::printEdges(char* fileName){
 			}
 			fprintf(fp,"\n");
 		}
-		fclose(fp);
+		closeDump(dump, fileName);
 	}
 }
 
@@ -91,10 +124,85 @@ void Printer::printEdges(char* fileName){
  * exist in the CFG.
  */
 void Printer::printAnalysis(char* fileName){
-	char tempName[256];
-	createFileName(tempName, fileName);
-	edgeAnalysis(tempName);
-	blockAnalysis(tempName);
+	DumpBuffer dump;
+	if (openDump(dump)){
+		edgeAnalysis(dump.fp);
+		blockAnalysis(dump.fp);
+		closeDump(dump, fileName);
+	}
+}
+
+/**
+ * Function that writes the trap sites of the function to
+ * the file with the given fileName: the basic block of each UDF #<site>
+ * @param fileName The name of the file to write to
+ * @param sites The basic block of each check, -1 if it is not part of a basic block
+ */
+void Printer::printTrapSites(char* fileName, vector<int>& sites){
+	DumpBuffer dump;
+	if (openDump(dump)){
+		FILE* fp = dump.fp;
+		fprintf(fp, "Trap sites of %s:\n", IDENTIFIER_POINTER(DECL_NAME(current_function_decl)));
+		// Above 256 checks the site numbers wrap, all checks sharing a number are listed
+		unsigned int nrOfSites = (sites.size() < 256) ? sites.size() : 256;
+		for(unsigned int site = 0; site < nrOfSites; site++){
+			fprintf(fp, "\tUDF #%u:", site);
+			if(site + 256 < sites.size()){
+				fprintf(fp, " ambiguous,");
+			}
+			for(unsigned int i = site; i < sites.size(); i += 256){
+				if(sites[i] < 0){
+					fprintf(fp, " outside the basic blocks");
+				}
+				else{
+					fprintf(fp, " basic block %i", sites[i]);
+				}
+				fprintf(fp, (i + 256 < sites.size()) ? "," : "\n");
+			}
+		}
+		closeDump(dump, fileName);
+	}
+}
+
+/**
+ * Function to set the dump level from the value of the dumpLevel argument
+ * @return bool Returns false if the value is unknown, the dump level is then left unchanged
+ */
+bool Printer::setDumpLevel(const char* level){
+	if(!strcmp(level, "none")){
+		dumpLevel = DUMP_NONE;
+	}
+	else if(!strcmp(level, "summary")){
+		dumpLevel = DUMP_SUMMARY;
+	}
+	else if(!strcmp(level, "edges")){
+		dumpLevel = DUMP_EDGES;
+	}
+	else if(!strcmp(level, "rtl")){
+		dumpLevel = DUMP_RTL;
+	}
+	else if(!strcmp(level, "delta")){
+		dumpLevel = DUMP_DELTA;
+	}
+	else{
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Function to get the current dump level
+ */
+DumpLevel Printer::getDumpLevel(){
+	return dumpLevel;
+}
+
+/**
+ * Function to determine whether or not per-function
+ * messages must be printed to stdout
+ */
+bool Printer::isVerbose(){
+	return (dumpLevel != DUMP_NONE);
 }
 
 // -------------------------------------- Private Section ------------------------------
@@ -109,10 +217,31 @@ void Printer::createFileName(char *name, char* fileName){
 	strcat(name,fileName);
 }
 
+/**
+ * Function to open an in-memory file to format a dump in
+ */
+bool Printer::openDump(DumpBuffer& dump){
+	dump.data = NULL;
+	dump.size = 0;
+	dump.fp = open_memstream(&dump.data, &dump.size);
+	return (dump.fp != NULL);
+}
+
+/**
+ * Function to close the in-memory file and hand
+ * its content to the writer thread
+ */
+void Printer::closeDump(DumpBuffer& dump, char* fileName){
+	char tempName[512];
+	createFileName(tempName, fileName);
+	fclose(dump.fp);
+	DumpWriter::enqueue(tempName, dump.data, dump.size);
+}
+
 /**
  * Function to print the existing edges to file.
  */
-void Printer::edgeAnalysis(char* fileName){
+void Printer::edgeAnalysis(FILE* fp){
 	// Variables to analyze the edges current function
 	unsigned int totalEdges = 0;
 	unsigned int uncondEdges = 0;
@@ -132,41 +261,33 @@ void Printer::edgeAnalysis(char* fileName){
 	unsigned int condEdges = totalEdges - uncondEdges;
 
 	// Print result of edge analysis
-	FILE* fp = fopen(fileName, "w");
-	if( fp != NULL){
-		fprintf(fp, "Edge Analysis:\n");
-		fprintf(fp, "\tTotal amount of edges: %i\n", totalEdges);
-		fprintf(fp, "\tNumber of unconditional edges: %i\n", uncondEdges);
-		fprintf(fp, "\tNumber of conditional edges: %i\n", condEdges);
-		fprintf(fp, "------------------------------------------------------\n");
-		fclose(fp);
-	}
+	fprintf(fp, "Edge Analysis:\n");
+	fprintf(fp, "\tTotal amount of edges: %i\n", totalEdges);
+	fprintf(fp, "\tNumber of unconditional edges: %i\n", uncondEdges);
+	fprintf(fp, "\tNumber of conditional edges: %i\n", condEdges);
+	fprintf(fp, "------------------------------------------------------\n");
 }
 
 /**
  * Function to print the number of basic blocks
  * and the length of each basic block to the file
  */
-void Printer::blockAnalysis(char* fileName){
+void Printer::blockAnalysis(FILE* fp){
 	unsigned int totalBlocks = n_basic_blocks_for_fn(cfun)-2;
 
-	FILE* fp = fopen(fileName, "a");
-	if (fp != NULL){
-		fprintf(fp, "Block Analysis:\n");
-		fprintf(fp, "\tTotal amount of basic blocks: %i\n", totalBlocks);
+	fprintf(fp, "Block Analysis:\n");
+	fprintf(fp, "\tTotal amount of basic blocks: %i\n", totalBlocks);
 
-		basic_block bb;
-		FOR_EACH_BB_FN(bb, cfun){
-			unsigned int index = bb->index -2;
-			unsigned int length = 0;
-			rtx_insn* insn;
-			FOR_BB_INSNS(bb, insn){
-				if(NONDEBUG_INSN_P(insn)){
-					length++;
-				}
+	basic_block bb;
+	FOR_EACH_BB_FN(bb, cfun){
+		unsigned int index = bb->index -2;
+		unsigned int length = 0;
+		rtx_insn* insn;
+		FOR_BB_INSNS(bb, insn){
+			if(NONDEBUG_INSN_P(insn)){
+				length++;
 			}
-			fprintf(fp, "\tLength of basic block %i: %i\n", index, length);
 		}
-		fclose(fp);
+		fprintf(fp, "\tLength of basic block %i: %i\n", index, length);
 	}
 }
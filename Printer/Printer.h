@@ -17,15 +17,51 @@
 
 #include <gcc-plugin.h>
 
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Which output the plugin produces for each protected function
+ * 	- none: no files and no per-function messages
+ * 	- summary: Analysis.txt
+ * 	- edges: Analysis.txt and Edges.txt
+ * 	- rtl: Analysis.txt, Edges.txt, RTL.txt and RTL_Protected.txt
+ * 	- delta: Analysis.txt, Edges.txt and RTL_Inserted.txt (only the inserted insns)
+ */
+enum DumpLevel{
+	DUMP_NONE, DUMP_SUMMARY, DUMP_EDGES, DUMP_RTL, DUMP_DELTA
+};
+
+/**
+ * Struct holding an in-memory dump file while it is being formatted
+ */
+struct DumpBuffer{
+	FILE* fp;
+	char* data;
+	size_t size;
+};
+
 class Printer{
 	public:
 		static void printRTL(char* fileName);
+		static void printDelta(char* fileName, int firstNewUID);
 		static void printEdges(char* fileName);
 		static void printAnalysis(char* fileName);
+		static void printTrapSites(char* fileName, vector<int>& sites);
+
+		static bool setDumpLevel(const char* level);
+		static DumpLevel getDumpLevel();
+		static bool isVerbose();
 	private:
+		static DumpLevel dumpLevel;
+
 		static void createFileName(char *name, char* fileName);
-		static void edgeAnalysis(char* fileName);
-		static void blockAnalysis(char* fileName);
+		static bool openDump(DumpBuffer& dump);
+		static void closeDump(DumpBuffer& dump, char* fileName);
+		static void edgeAnalysis(FILE* fp);
+		static void blockAnalysis(FILE* fp);
 };
 
 
@@ -0,0 +1,77 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+#include "CFED_Trap.h"
+
+extern void CFED_Detected(void);
+
+void CFED_Fault_Decode(const uint32_t* frame);
+
+/**
+ * Function to decode the trap that raised the fault
+ * @param frame The exception frame stacked by the fault: r0-r3, r12, lr, pc, xpsr
+ * @param site Set to the decoded trap
+ * @return 1 if the stacked PC points to a 16-bit UDF, 0 otherwise
+ */
+int CFED_DecodeTrap(const uint32_t* frame, CFED_TrapSite* site){
+	uint32_t pc = frame[6] & ~1u;
+	uint16_t insn = *(const uint16_t*) (uintptr_t) pc;
+	if((insn & 0xFF00) != 0xDE00){
+		return 0;
+	}
+	site->pc = pc;
+	site->site = insn & 0xFF;
+	return 1;
+}
+
+/**
+ * Fault handler: passes the exception frame, on the main or the process stack
+ * depending on bit 2 of EXC_RETURN, to CFED_Fault_Decode.
+ * Only uses ARMv6-M instructions, so it works on all supported targets.
+ */
+__attribute__((naked)) void CFED_Fault_Handler(void){
+	__asm volatile(
+		"movs r0, #4\n"
+		"mov r1, lr\n"
+		"tst r0, r1\n"
+		"beq 1f\n"
+		"mrs r0, psp\n"
+		"b 2f\n"
+		"1:\n"
+		"mrs r0, msp\n"
+		"2:\n"
+		"ldr r1, =CFED_Fault_Decode\n"
+		"bx r1\n"
+		".ltorg\n"
+	);
+}
+
+/**
+ * Function called by CFED_Fault_Handler with the exception frame
+ */
+void CFED_Fault_Decode(const uint32_t* frame){
+	CFED_TrapSite site;
+	if(CFED_DecodeTrap(frame, &site)){
+		CFED_TrapDetected(&site);
+	}
+	else{
+		CFED_OtherFault(frame);
+	}
+}
+
+/**
+ * Called when a check failed, override it to log the site
+ */
+__attribute__((weak)) void CFED_TrapDetected(const CFED_TrapSite* site){
+	CFED_Detected();
+}
+
+/**
+ * Called for faults that are not raised by a check
+ */
+__attribute__((weak)) void CFED_OtherFault(const uint32_t* frame){
+	while(1);
+}
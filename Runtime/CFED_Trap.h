@@ -0,0 +1,47 @@
+/*
+ * This GCC Plugin has been developed during a research grant from the Baekeland program of the Flemish Agency for Innovation and Entrepreneurship (VLAIO) in cooperation with Televic Healthcare NV, under grant agreement IWT 150696.
+ * Copyright (c) 2019 Jens Vankeirsbilck & KU Leuven LRD & Televic Healthcare NV.
+ * Distributed under the MIT "Expat" License. (See accompanying file LICENSE.txt)
+ */
+
+/*
+ * Header file of the trap decoder, to be compiled with the target code
+ * (not with the plugin) when using -fplugin-arg-CFED_plugin64-detection=trap.
+ *
+ * A failed check then executes UDF #<site>, which raises a HardFault
+ * (or a UsageFault on ARMv7-M if it is enabled). Install CFED_Fault_Handler
+ * as the handler of that fault, e.g. by defining
+ * 	void HardFault_Handler(void) __attribute__((alias("CFED_Fault_Handler")));
+ * It decodes the site from the stacked PC and calls CFED_TrapDetected,
+ * which calls CFED_Detected unless the application overrides it.
+ * Other faults are passed to CFED_OtherFault, which loops forever unless overridden.
+ *
+ * The site is the number of the check in its function, modulo 256. The function
+ * follows from the PC, the basic block from Traps.txt in GCC_Plugin_Output/<function>.
+ * Functions with more than 256 checks reuse site numbers, Traps.txt then lists
+ * every basic block that shares the site.
+ */
+
+#ifndef RUNTIME_CFED_TRAP_H_
+#define RUNTIME_CFED_TRAP_H_
+
+#include <stdint.h>
+
+/**
+ * Struct holding a decoded trap
+ * Contains:
+ * 	- The address of the UDF instruction
+ * 	- The number of the check in its function, modulo 256
+ */
+typedef struct{
+	uint32_t pc;
+	uint8_t site;
+} CFED_TrapSite;
+
+int CFED_DecodeTrap(const uint32_t* frame, CFED_TrapSite* site);
+
+void CFED_Fault_Handler(void);
+void CFED_TrapDetected(const CFED_TrapSite* site);
+void CFED_OtherFault(const uint32_t* frame);
+
+#endif /* RUNTIME_CFED_TRAP_H_ */
@@ -7,6 +7,7 @@
 #include <gcc-plugin.h>
 #include <basic-block.h>
 #include <rtl.h>
+#include <ggc.h>
 
 #include "ARMv6M_Functions.h"
 #include "AsmGen.h"
@@ -15,14 +16,15 @@
 ARMv6M_Functions::ARMv6M_Functions(processor_type cpu)
 	:ARM_ISA(cpu) {}
 
-void ARMv6M_Functions::changeCBZ(){
+void ARMv6M_Functions::changeCBZ(vector<bool> condUpdateBlocks){
 	// Does not exist in ARMv6M, so nothing to do
 }
 
 /**
  * Function to emit the necessary PUSH instruction
  * Emits STR reg, [r6] for each necessary register (reg)
- * Uses the pushPopStrings variable and the emitAsmInput method of AsmGen class.
+ * The asm strings are allocated in GC memory, they must live as long as the RTL.
+ * Uses the emitAsmInput method of AsmGen class.
  */
 void ARMv6M_Functions::insertPush(vector<unsigned int> regs){
 	// 1) Get necessary emit variables
@@ -36,15 +38,15 @@ void ARMv6M_Functions::insertPush(vector<unsigned int> regs){
 		next = AsmGen::emitAddRegInt(this->stackPointer, -4, next, bb, after);
 		after = true;
 		string push = "str r" + to_string(*it) + ", [r" + to_string(this->stackPointer) + "]";
-		pushPopStrings.push_back(push);
-		next = AsmGen::emitAsmInput(pushPopStrings[pushPopStrings.size()-1].c_str(), next, bb, after);
+		next = AsmGen::emitAsmInput(ggc_strdup(push.c_str()), next, bb, after);
 	}
 }
 
 /**
  * Function to emit the necessary POP instruction
  * Emits LDR reg, [r6] for each necessary register (reg)
- * Uses the pushPopStrings variable and the emitAsmInput method of AsmGen class.
+ * The asm strings are allocated in GC memory, they must live as long as the RTL.
+ * Uses the emitAsmInput method of AsmGen class.
  */
 void ARMv6M_Functions::insertPop(vector<unsigned int> regs, rtx_insn* last, basic_block bb){
 	bool after = false;
@@ -52,8 +54,7 @@ void ARMv6M_Functions::insertPop(vector<unsigned int> regs, rtx_insn* last, basi
 	vector<unsigned int>::const_iterator it;
 	for(it = regs.begin(); it != regs.end(); it++){
 		string popBB = "ldr r" + to_string(*it) + ", [r" + to_string(this->stackPointer) + "]";
-		pushPopStrings.push_back(popBB);
-		last = AsmGen::emitAsmInput(pushPopStrings[pushPopStrings.size()-1].c_str(), last, bb, after);
+		last = AsmGen::emitAsmInput(ggc_strdup(popBB.c_str()), last, bb, after);
 		after = true;
 		last = AsmGen::emitAddRegInt(this->stackPointer, 4, last, bb, after);
 	}
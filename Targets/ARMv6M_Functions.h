@@ -21,7 +21,7 @@ class ARMv6M_Functions : public ARM_ISA{
 		ARMv6M_Functions(processor_type cpu);
 		~ARMv6M_Functions(){}
 
-		void changeCBZ();
+		void changeCBZ(vector<bool> condUpdateBlocks);
 
 	private:
 		void insertPush(vector<unsigned int> regs);
@@ -7,10 +7,13 @@
 #include <gcc-plugin.h>
 #include <basic-block.h>
 #include <rtl.h>
+#include <ggc.h>
 
 #include "ARMv7M_Functions.h"
 #include "AsmGen.h"
 #include "InstrType.h"
+#include "Printer.h"
+#include "PhaseTimer.h"
 
 
 ARMv7M_Functions::ARMv7M_Functions(processor_type cpu)
@@ -22,13 +25,24 @@ ARMv7M_Functions::ARMv7M_Functions(processor_type cpu)
  * 	- CBNZ into a CMP and a BNE instruction;
  * Necessary for certain CFE detection methods that
  * use conditional updating of a control variable.
+ * Only the CBZ instructions ending a basic block marked in
+ * condUpdateBlocks are split, the others are kept as they are.
  */
-void ARMv7M_Functions::changeCBZ(){
+void ARMv7M_Functions::changeCBZ(vector<bool> condUpdateBlocks){
+	vector<rtx_insn*> labels = createLabelMap();
+	unsigned int totalCBZ = 0;
+	unsigned int keptCBZ = 0;
 	basic_block bb;
 	FOR_EACH_BB_FN(bb, cfun){
+		unsigned int idBB = (bb->index) - 2;
 		rtx_insn* insn;
 		FOR_BB_INSNS(bb, insn){
 			if(InstrType::isCBZ(insn)){
+				totalCBZ++;
+				if(!condUpdateBlocks[idBB]){
+					keptCBZ++;
+					continue;
+				}
 				rtx par = XEXP(insn, 3);
 				rtx set = XVECEXP(par, 0,0);
 				rtx ifThenElse = XEXP(set, 1);
@@ -39,7 +53,7 @@ void ARMv7M_Functions::changeCBZ(){
 				unsigned int regNr = XINT(regRtx, 0);
 				rtx_code cond = InstrType::getCondCode(insn);
 				AsmGen::emitCmpRegInt(regNr, 0, insn, bb, false);
-				rtx_insn* labelToUse = findLabel(labelNr);
+				rtx_insn* labelToUse = labels[labelNr];
 				if (cond == EQ){
 					XEXP(insn,3) = createBeq(labelToUse);
 				}
@@ -47,15 +61,21 @@ void ARMv7M_Functions::changeCBZ(){
 					XEXP(insn, 3) = createBne(labelToUse);
 				}
 				(insn->u).fld[5].rt_int = -1;
+				InstrType::invalidate(insn);
 			}
 		}
 	}
+	PhaseTimer::count(STAT_CBZ_SPLIT, totalCBZ - keptCBZ);
+	if(totalCBZ != 0 && Printer::isVerbose()){
+		printf("\t\x1b[96mCBZ/CBNZ kept: %u of %u\x1b[0m\n", keptCBZ, totalCBZ);
+	}
 }
 
 /**
  * Function to emit the necessary PUSH instruction
  * Emits STMDB r6!, {<reglist>} with each necessary register contained in <reglist>
- * Uses the pushPopStrings variable and the emitAsmInput method of AsmGen class.
+ * The asm strings are allocated in GC memory, they must live as long as the RTL.
+ * Uses the emitAsmInput method of AsmGen class.
  */
 void ARMv7M_Functions::insertPush(vector<unsigned int> regs){
 	// 1) Get necessary emit variables
@@ -68,14 +88,14 @@ void ARMv7M_Functions::insertPush(vector<unsigned int> regs){
 		push += ", r" + to_string(regs[i]);
 	}
 	string fullPush = "STMDB r" + to_string(this->stackPointer) + "!, {" + push + "}";
-	pushPopStrings.push_back(fullPush);
-	AsmGen::emitAsmInput(pushPopStrings[pushPopStrings.size()-1].c_str(), next, bb, false);
+	AsmGen::emitAsmInput(ggc_strdup(fullPush.c_str()), next, bb, false);
 }
 
 /**
  * Function to emit the necessary POP instruction
  * Emits LDMIA r6!, {<reglist} with each necessary register contained in <reglist>
- * Uses the pushPopStrings variable and the emitAsmInput method of AsmGen class.
+ * The asm strings are allocated in GC memory, they must live as long as the RTL.
+ * Uses the emitAsmInput method of AsmGen class.
  */
 void ARMv7M_Functions::insertPop(vector<unsigned int> regs, rtx_insn* last, basic_block bb){
 	string pop = "r" + to_string(regs[regs.size()-1]);
@@ -83,8 +103,7 @@ void ARMv7M_Functions::insertPop(vector<unsigned int> regs, rtx_insn* last, basi
 		pop += ", r" + to_string(regs[i]);
 	}
 	string popPush = "LDMIA r" + to_string(this->stackPointer) + "!, {" + pop + "}";
-	pushPopStrings.push_back(popPush);
-	AsmGen::emitAsmInput(pushPopStrings[pushPopStrings.size()-1].c_str(), last, bb, false);
+	AsmGen::emitAsmInput(ggc_strdup(popPush.c_str()), last, bb, false);
 }
 
 /**
@@ -108,21 +127,20 @@ rtx ARMv7M_Functions::createBne(rtx_insn* codeLabel){
 }
 
 /**
- * Function to find the label rtx_insn containing the specified number
- * Used to split CBZ and CBNZ instructions.
+ * Function to create a map from label number to the label rtx_insn
+ * Walks the function once, so that splitting a CBZ and CBNZ instruction
+ * can find its label immediately.
  */
-rtx_insn* ARMv7M_Functions::findLabel(unsigned int number){
+vector<rtx_insn*> ARMv7M_Functions::createLabelMap(){
+	vector<rtx_insn*> labels(max_label_num(), (rtx_insn*)0x00);
 	basic_block bb;
 	rtx_insn* insn;
 	FOR_EACH_BB_FN(bb, cfun){
 		FOR_BB_INSNS(bb, insn){
 			if(LABEL_P(insn)){
-				int currentNr = XINT(insn,5);
-				if(currentNr == number){
-					return insn;
-				}
+				labels[XINT(insn,5)] = insn;
 			}
 		}
 	}
-	return 0x00;
+	return labels;
 }
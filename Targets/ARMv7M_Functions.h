@@ -21,7 +21,7 @@ class ARMv7M_Functions : public ARM_ISA{
 		ARMv7M_Functions(processor_type cpu);
 		~ARMv7M_Functions(){}
 
-		void changeCBZ();
+		void changeCBZ(vector<bool> condUpdateBlocks);
 
 	private:
 		void insertPush(vector<unsigned int> regs);
@@ -30,7 +30,7 @@ class ARMv7M_Functions : public ARM_ISA{
 		// Functions to change the CBZ
 		static rtx createBeq(rtx_insn* codeLabel);
 		static rtx createBne(rtx_insn* codeLabel);
-		static rtx_insn* findLabel(unsigned int number);
+		static vector<rtx_insn*> createLabelMap();
 };
 
 
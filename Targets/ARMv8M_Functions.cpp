@@ -15,7 +15,7 @@
 ARMv8M_Functions::ARMv8M_Functions(processor_type cpu)
 	:ARM_ISA(cpu) {}
 
-void ARMv8M_Functions::changeCBZ(){
+void ARMv8M_Functions::changeCBZ(vector<bool> condUpdateBlocks){
 	// // not supported for the moment
 }
 
@@ -21,7 +21,7 @@ class ARMv8M_Functions : public ARM_ISA{
 		ARMv8M_Functions(processor_type cpu);
 		~ARMv8M_Functions(){}
 
-		void changeCBZ();
+		void changeCBZ(vector<bool> condUpdateBlocks);
 
 	private:
 		void insertPush(vector<unsigned int> regs);
@@ -7,6 +7,12 @@
 #include <gcc-plugin.h>
 #include <basic-block.h>
 #include <rtl.h>
+#include <hard-reg-set.h>
+#include <emit-rtl.h>
+#include <df.h>
+
+#include <stdlib.h>
+#include <algorithm>
 
 #include "ArmISA_Functions.h"
 #include "InstrType.h"
@@ -84,23 +90,71 @@ ISAs ARM_ISA::getISAtarget(processor_type cpu){
  * Constructor, initializes
  * 	- stackPointer constant: hard coded as register r6 for the moment
  * 	- cpu: provided as argument
- * 	- pushPopStrings vector: create an empty vector of 6 places
  */
 ARM_ISA::ARM_ISA(processor_type cpu)
 	: stackPointer(6){
 	this->cpu = cpu;
-	this->pushPopStrings.reserve(6);
+}
+
+/**
+ * Function to set the registers used to implement the CFE detection techniques
+ * @param registers Comma separated list of registers, e.g. "r7,r5,r4", the first one
+ * holds the signature. NULL to use the default registers.
+ * Only the callee-saved registers r4, r5 and r7 to r11 can be used, on ARMv6-M only
+ * the low registers r4, r5 and r7. r6 is the stack pointer of the second stack.
+ * @param compactEncoding Whether the default registers are the low registers r7, r5 and r4,
+ * which most inserted instructions can use in their 16-bit Thumb encoding
+ */
+void ARM_ISA::setRegisters(const char* registers, bool compactEncoding){
+	this->registers.clear();
+	if(registers == NULL){
+		if(compactEncoding){
+			this->registers.push_back(7);
+			this->registers.push_back(5);
+			this->registers.push_back(4);
+		}
+		return;
+	}
+
+	const char* pos = registers;
+	while(*pos != '\0'){
+		if((*pos == 'r') || (*pos == 'R')){
+			pos++;
+		}
+		char* end;
+		unsigned long reg = strtoul(pos, &end, 10);
+		if(end == pos){
+			throw "Wrong registers provided. Use a comma separated list such as r7,r5,r4";
+		}
+		bool allowed = (reg == 4) || (reg == 5) || ((reg >= 7) && (reg <= 11));
+		if(!allowed || ((ARM_ISA::getISAtarget(cpu) == ARMv6M) && (reg > 7))){
+			throw "Wrong registers provided. Only r4, r5 and r7 to r11 can be used, on ARMv6-M only r4, r5 and r7";
+		}
+		if(find(this->registers.begin(), this->registers.end(), reg) != this->registers.end()){
+			throw "Wrong registers provided. Each register can only be used once";
+		}
+		this->registers.push_back(reg);
+		pos = end;
+		if(*pos == ','){
+			pos++;
+		}
+		else if(*pos != '\0'){
+			throw "Wrong registers provided. Use a comma separated list such as r7,r5,r4";
+		}
+	}
 }
 
 /**
  * Function to retrieve the registers that can be used
  * to implement the selected CFE detection technique.
- * For
- * 	- ARMv6-M these are r7, r5 and r4;
- * 	- ARMv7-M and ARMv8-M these are r11, r10 and r9.
- * These are hard coded for the moment.
+ * These are the registers set through setRegisters, by default for
+ * 	- ARMv6-M r7, r5 and r4;
+ * 	- ARMv7-M and ARMv8-M r11, r10 and r9.
  */
 vector<unsigned int> ARM_ISA::getNecessaryRegisters(){
+	if(!this->registers.empty()){
+		return this->registers;
+	}
 	vector<unsigned int> regs;
 	switch(ARM_ISA::getISAtarget(cpu)){
 		case ARMv6M:
@@ -119,6 +173,42 @@ vector<unsigned int> ARM_ISA::getNecessaryRegisters(){
 	return regs;
 }
 
+/**
+ * Function to retrieve the registers the current function never uses
+ * and that can hold the variables of a technique (regAllocation=free).
+ * Only callee-saved registers qualify: the functions called by the current
+ * function preserve them, and the technique pushes and pops them itself.
+ * Registers reserved with -ffixed-<reg> qualify as well.
+ * The registers of getNecessaryRegisters come first, followed by the others of
+ * 	- nothing else for ARMv6-M, as the techniques need low registers there;
+ * 	- r8, r5, r4 and r7 for ARMv7-M and ARMv8-M.
+ * The stack pointer of the second stack and the frame pointer never qualify.
+ */
+vector<unsigned int> ARM_ISA::getUnusedRegisters(){
+	vector<unsigned int> candidates = getNecessaryRegisters();
+	if(ARM_ISA::getISAtarget(cpu) != ARMv6M){
+		candidates.insert(candidates.end(), {8, 5, 4, 7});
+	}
+
+	vector<unsigned int> regs;
+	for(unsigned int i = 0; i < candidates.size(); i++){
+		unsigned int reg = candidates[i];
+		if((reg == 0) || (reg == this->stackPointer) || df_regs_ever_live_p(reg)){
+			continue;
+		}
+		if(find(regs.begin(), regs.end(), reg) != regs.end()){
+			continue;
+		}
+		if((reg == HARD_FRAME_POINTER_REGNUM) && frame_pointer_needed){
+			continue;
+		}
+		if(fixed_regs[reg] || !call_used_regs[reg]){
+			regs.push_back(reg);
+		}
+	}
+	return regs;
+}
+
 /**
  * Function to implement the necessary PUSH and POP instructions
  */
@@ -42,18 +42,20 @@ class ARM_ISA{
 		ARM_ISA(processor_type cpu);
 		virtual ~ARM_ISA(){}
 
+		void setRegisters(const char* registers, bool compactEncoding);
 		vector<unsigned int> getNecessaryRegisters();
+		vector<unsigned int> getUnusedRegisters();
 
 		void insertPushPop(vector<unsigned int> regs);
 
-		virtual void changeCBZ() = 0;
+		virtual void changeCBZ(vector<bool> condUpdateBlocks) = 0;
 
 	protected:
-		vector<string> pushPopStrings;
 		const unsigned char stackPointer;
 
 	private:
 		processor_type cpu;
+		vector<unsigned int> registers;		// Registers set through setRegisters, empty for the default ones
 
 		virtual void insertPush(vector<unsigned int> regs) = 0;
 		virtual void insertPop(vector<unsigned int> regs, rtx_insn* last, basic_block bb) = 0;